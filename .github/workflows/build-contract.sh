@@ -15,7 +15,7 @@ ee cmake --version
 # build
 ee mkdir -p build
 ee pushd build
-ee "cmake -DCMAKE_BUILD_TYPE=$DCMAKE_BUILD_TYPE -DWITH_TEST_ACTIONS=$DWITH_TEST_ACTIONS -DWITH_LARGE_STACK=$DWITH_TEST_ACTIONS .."
+ee "cmake -DCMAKE_BUILD_TYPE=$DCMAKE_BUILD_TYPE -DWITH_TEST_ACTIONS=$DWITH_TEST_ACTIONS -DWITH_LARGE_STACK=$DWITH_TEST_ACTIONS -DWITH_TX_STATS=$DWITH_TEST_ACTIONS -DWITH_HOST_CRYPTO=${DWITH_HOST_CRYPTO:-off} .."
 ee make -j "$(nproc)"
 
 # pack
@@ -9,10 +9,13 @@ function ee()
 }
 
 ee pushd tests/build
-if [ "$DWITH_TEST_ACTIONS" = "on" ] || [ "$DWITH_TEST_ACTIONS" = "true" ]; then
-ee "ctest -R consensus_tests -j \"$(nproc)\" --output-on-failure -T Test"
+if [ "$DWITH_HOST_CRYPTO" = "on" ] || [ "$DWITH_HOST_CRYPTO" = "true" ]; then
+# every test goes through the host crypto functions
+ee "ctest -j \"$(nproc)\" --output-on-failure -T Test"
+elif [ "$DWITH_TEST_ACTIONS" = "on" ] || [ "$DWITH_TEST_ACTIONS" = "true" ]; then
+ee "ctest -R 'consensus_tests|test_build_tests' -j \"$(nproc)\" --output-on-failure -T Test"
 else
-ee "ctest -E consensus_tests -j \"$(nproc)\" --output-on-failure -T Test"
+ee "ctest -E 'consensus_tests|test_build_tests' -j \"$(nproc)\" --output-on-failure -T Test"
 fi
 
 cp "$(find ./Testing -name 'Test.xml' | sort | tail -n '1')" "../../${XUNIT_FILENAME:-test-results.xml}"
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <limits>
+#include <evm_runtime/types.hpp>
+#include <silkworm/core/common/base.hpp>
+
+namespace evm_runtime { namespace abi {
+
+using silkworm::ByteView;
+
+static constexpr uint64_t word_size = 32;
+static constexpr char err_msg_read_past_end[] = "datastream attempted to read past the end";
+
+// Splits calldata into its 4 byte method id and the encoded arguments
+inline std::pair<uint32_t, ByteView> split_method_id(ByteView calldata) {
+    eosio::check(calldata.size() >= 4, err_msg_read_past_end);
+    uint32_t id = (uint32_t(calldata[0]) << 24) | (uint32_t(calldata[1]) << 16) | (uint32_t(calldata[2]) << 8) | uint32_t(calldata[3]);
+    return {id, calldata.substr(4)};
+}
+
+// Reads Solidity ABI encoded arguments in place. Offsets are relative to the
+// start of the arguments, as in the head of the encoding; dynamic values are
+// returned as views over the underlying buffer
+class decoder {
+public:
+    explicit decoder(ByteView args) : args_{args} {}
+
+    uint256 read_uint256(uint64_t offset) const {
+        return intx::be::unsafe::load<uint256>(view(offset, word_size).data());
+    }
+
+    // i-th word of the head
+    uint256 head(uint64_t index) const {
+        return read_uint256(index * word_size);
+    }
+
+    // offset or length word, bounded so it can be used for further reads
+    uint64_t read_offset(uint64_t offset) const {
+        auto v = read_uint256(offset);
+        eosio::check(v < std::numeric_limits<uint32_t>::max(), "invalid length");
+        return static_cast<uint64_t>(v);
+    }
+
+    // decoder whose offsets are relative to offset, for the tail of
+    // dynamic arrays and tuples
+    decoder at(uint64_t offset) const {
+        view(offset, 0);
+        return decoder{args_.substr(offset)};
+    }
+
+    // bytes/string: a length word followed by the data padded to a multiple of 32
+    ByteView read_bytes(uint64_t offset) const {
+        uint64_t size = read_offset(offset);
+        view(offset + word_size, (size + word_size - 1) / word_size * word_size);
+        return args_.substr(offset + word_size, size);
+    }
+
+private:
+    ByteView view(uint64_t offset, uint64_t size) const {
+        eosio::check(offset <= args_.size() && size <= args_.size() - offset, err_msg_read_past_end);
+        return args_.substr(offset, size);
+    }
+
+    ByteView args_;
+};
+
+} //namespace abi
+} //namespace evm_runtime
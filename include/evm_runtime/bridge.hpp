@@ -1,15 +1,13 @@
 #pragma once
 
 #include <evm_runtime/types.hpp>
+#include <evm_runtime/abi.hpp>
 
 namespace evm_runtime { namespace bridge {
 
-struct message_v0 {
-    static constexpr uint32_t id = 0xf781185b; //sha3('bridgeMsgV0(string,bool,bytes)')[:4]
-
+// EOS account name carried as an ABI string
+struct account_string {
     string account;
-    bool   force_atomic; //currently only atomic is supported
-    bytes  data;
 
     name get_account_as_name() const {
         if(!account_.has_value()) {
@@ -22,53 +20,87 @@ struct message_v0 {
     mutable std::optional<name> account_;
 };
 
-using message = std::variant<message_v0>;
+struct message_v0 : account_string {
+    static constexpr uint32_t id = 0xf781185b; //sha3('bridgeMsgV0(string,bool,bytes)')[:4]
 
-message_v0 decode_message_v0(eosio::datastream<const uint8_t*>& ds) {
+    bool   force_atomic; //currently only atomic is supported
+    bytes  data;
+};
+
+struct message_v1 {
+    static constexpr uint32_t id = 0x60e9fbd3; //sha3('bridgeMsgV1(bool,(string,uint256,bytes)[])')[:4]
+
+    struct entry : account_string {
+        uint256 value;
+        bytes   data;
+    };
+
+    bool               atomic; //false queues the entries, they are delivered by processq
+    std::vector<entry> entries;
+};
+
+using message = std::variant<message_v0, message_v1>;
+
+inline message_v0 decode_message_v0(const abi::decoder& args) {
     // offset_p1 (32) + p2_value (32) + offset_p3 (32)
     // p1_len    (32) + p1_data   ((p1_len+31)/32*32)
     // p3_len    (32) + p3_data   ((p2_len+31)/32*32)
-    uint256  offset_p1, value_p2, offset_p3;
-
-    ds >> offset_p1;
+    uint256 offset_p1 = args.head(0);
     eosio::check(offset_p1 == 0x60, "invalid p1 offset");
-    ds >> value_p2;
+    uint256 value_p2 = args.head(1);
     eosio::check(value_p2 <= 1, "invalid p2 value");
-    ds >> offset_p3;
+    uint256 offset_p3 = args.head(2);
     eosio::check(offset_p3 == 0xA0, "invalid p3 offset");
 
     message_v0 res;
     res.force_atomic = value_p2 ? true : false;
 
-    auto get_length=[&]() -> uint32_t {
-        uint256 len;
-        ds >> len;
-        eosio::check(len < std::numeric_limits<uint32_t>::max(), "invalid length");
-        return static_cast<uint32_t>(len);
-    };
+    auto p1 = args.read_bytes(0x60);
+    res.account.assign((const char*)p1.data(), p1.size());
 
-    uint32_t p1_len = get_length();
-    auto p1_len_32 = (p1_len+31)/32*32;
-    res.account.resize(p1_len_32);
-    ds.read(res.account.data(), p1_len_32);
-    res.account.resize(p1_len);
+    auto p3 = args.read_bytes(0x60 + abi::word_size + (p1.size()+31)/32*32);
+    res.data.assign(p3.begin(), p3.end());
 
-    uint32_t p3_len = get_length();
-    auto p3_len_32 = (p3_len+31)/32*32;
-    res.data.resize(p3_len_32);
-    ds.read(res.data.data(), p3_len_32);
-    res.data.resize(p3_len);
+    return res;
+}
+
+inline message_v1 decode_message_v1(const abi::decoder& args) {
+    // p1_value (32) + offset_p2 (32)
+    // p2_len   (32) + p2_len * offset_entry (32)
+    // entry:   offset_account (32) + value (32) + offset_data (32) + account + data
+    uint256 value_p1 = args.head(0);
+    eosio::check(value_p1 <= 1, "invalid p1 value");
+
+    auto p2 = args.at(args.read_offset(abi::word_size));
+    uint64_t count = p2.read_offset(0);
+    eosio::check(count > 0, "empty bridge message");
+    auto items = p2.at(abi::word_size);
+
+    message_v1 res;
+    res.atomic = value_p1 ? true : false;
+
+    // entries are appended as they are read, so a bogus count fails on the
+    // first missing entry instead of reserving memory for it
+    for(uint64_t i = 0; i < count; ++i) {
+        auto item = items.at(items.read_offset(i * abi::word_size));
+        auto& e = res.entries.emplace_back();
+
+        auto account = item.read_bytes(item.read_offset(0));
+        e.account.assign((const char*)account.data(), account.size());
+        e.value = item.read_uint256(abi::word_size);
+        auto data = item.read_bytes(item.read_offset(2 * abi::word_size));
+        e.data.assign(data.begin(), data.end());
+    }
 
     return res;
 }
 
-std::optional<message> decode_message(ByteView bv) {
-    // method_id (4)
-    eosio::datastream<const uint8_t*> ds(bv.data(), bv.size());
-    uint32_t method_id;
-    ds >> method_id;
+inline std::optional<message> decode_message(ByteView bv) {
+    auto [method_id, args] = abi::split_method_id(bv);
+    abi::decoder decoder{args};
 
-    if(method_id == __builtin_bswap32(message_v0::id)) return decode_message_v0(ds);
+    if(method_id == message_v0::id) return decode_message_v0(decoder);
+    if(method_id == message_v1::id) return decode_message_v1(decoder);
     return {};
 }
 
@@ -40,6 +40,9 @@ struct config_wrapper {
     uint64_t get_evm_version_and_maybe_promote();
     void set_evm_version(uint64_t new_version);
 
+    uint32_t get_gc_budget()const;
+    void set_gc_budget(uint32_t gc_budget);
+
     void set_fee_parameters(const fee_parameters& fee_params,
                             bool allow_any_to_be_unspecified);
 
@@ -58,10 +58,62 @@ public:
     */
    [[eosio::action]] void freeze(bool value);
 
-   [[eosio::action]] void exec(const exec_input& input, const std::optional<exec_callback>& callback);
+   /**
+    * @brief Execute a read-only call
+    *
+    * @param input Call to execute
+    * @param callback If set, the output is sent to this action instead of being returned in the action return value
+    * @param overrides Account changes applied on top of the current state before the call. The call sees them as
+    *                  committed state (SSTORE gas and refunds use them as original values). They are never written.
+    */
+   [[eosio::action]] void exec(const exec_input& input, const std::optional<exec_callback>& callback,
+                               const eosio::binary_extension<std::vector<state_override>>& overrides);
+
+   /**
+    * @brief Execute several read-only calls against the same EVM state
+    *
+    * Each input is executed as by exec, independently of the others (no input sees the changes made by another
+    * one). The outputs are returned in order, as a packed std::vector<exec_output>, in the action return value.
+    *
+    * @param overrides Applied before each of the calls, see exec
+    */
+   [[eosio::action]] void execbatch(const std::vector<exec_input>& inputs,
+                                    const eosio::binary_extension<std::vector<state_override>>& overrides);
+
+   /**
+    * @brief Estimate the gas limit a transaction needs to execute a call
+    *
+    * The call is executed as by exec, with a gas limit of 0x7ffffffffff (intrinsic gas included). If it succeeds,
+    * the lowest gas limit with which it still succeeds is found by binary search and reported in the gas_used field
+    * of the returned exec_output. Otherwise the output of the failed call is returned unchanged.
+    *
+    * @param overrides See exec
+    */
+   [[eosio::action]] void estimategas(const exec_input& input,
+                                      const eosio::binary_extension<std::vector<state_override>>& overrides);
 
    [[eosio::action]] void pushtx(eosio::name miner, bytes rlptx);
 
+   /**
+    * @brief Execute several RLP encoded transactions in the same EVM block
+    *
+    * Equivalent to one pushtx per transaction, in order, but the block header, chain config and
+    * state caches are set up once for the whole batch. An evmtx event is emitted per transaction.
+    */
+   [[eosio::action]] void pushtxs(eosio::name miner, std::vector<bytes> rlptxs);
+
+   /**
+    * @brief Bridge funds from the balance of an opened account to several EVM addresses
+    *
+    * Meant to be paired with a single token transfer to the contract with the account name as memo. Each
+    * deposit is charged the ingress bridge fee and is recorded by its own bridge transaction and evmtx
+    * event, exactly as if it had been sent by a transfer with an 0x address memo.
+    *
+    * @param from Opened account whose balance is debited
+    * @param deposits Destination addresses and amounts, in EOS
+    */
+   [[eosio::action]] void batchdeposit(eosio::name from, const std::vector<deposit_entry>& deposits);
+
    [[eosio::action]] void open(eosio::name owner);
 
    [[eosio::action]] void close(eosio::name owner);
@@ -74,17 +126,91 @@ public:
    /// @return true if all garbage has been collected
    [[eosio::action]] bool gc(uint32_t max);
 
+   /**
+    * @brief Collect the storage of a single destroyed account, restricted to a range of row primary keys
+    *
+    * Transactions working on disjoint ranges of the same gcstore row do not touch the same rows, so the
+    * storage of a large contract can be drained by several of them in the same block. storage2 primary keys
+    * are the home key of the slot (see storage2_key, every word of the slot is mixed into it) or, after a
+    * collision, one of the keys right after it, so they are spread evenly over [0, 2^64) and equal sized
+    * subranges of it hold about the same number of rows: to use N transactions, give each one [k * 2^64 / N,
+    * (k + 1) * 2^64 / N - 1]. Slot 0 always lands on primary key 0. Rows of accounts not migrated by migstorage are
+    * different: the legacy `storage` table uses dense primary keys from 0, so all of them fall in the
+    * lowest range. For such accounts split [0, highest row id] instead. The gcstore row itself
+    * is removed by the regular gc action once its storage is empty.
+    *
+    * Requires the authority of the contract account, see the deployment plan for a dedicated permission.
+    *
+    * @param id gcstore row
+    * @param lower Lowest primary key of the range
+    * @param upper Highest primary key of the range (inclusive)
+    * @param max Maximum number of rows erased by this call
+    * @return true if no row is left in the range
+    */
+   [[eosio::action]] bool gcrange(uint64_t id, uint64_t lower, uint64_t upper, uint32_t max);
+
+   /**
+    * @brief Incrementally move account storage from the legacy `storage` table to `storage2`
+    *
+    * Account rows written before the code hash was kept in them get it filled in as they are migrated.
+    *
+    * @param max Maximum number of rows (and accounts) processed by this call.
+    * @return true if the storage of all accounts has been migrated
+    */
+   [[eosio::action]] bool migstorage(uint32_t max);
+
    
    [[eosio::action]] void call(eosio::name from, const bytes& to, const bytes& value, const bytes& data, uint64_t gas_limit);
    [[eosio::action]] void admincall(const bytes& from, const bytes& to, const bytes& value, const bytes& data, uint64_t gas_limit);
 
-   [[eosio::action]] void bridgereg(eosio::name receiver, eosio::name handler, const eosio::asset& min_fee);
+   /**
+    * @brief Register the handler of the bridge messages sent to a receiver
+    *
+    * @param max_queued Maximum number of non-atomic messages waiting in the queue of the receiver at any time.
+    *                   Zero (the default) rejects non-atomic messages. The contract pays the RAM of the queue,
+    *                   which is why registration also requires its authority.
+    */
+   [[eosio::action]] void bridgereg(eosio::name receiver, eosio::name handler, const eosio::asset& min_fee,
+                                    const eosio::binary_extension<uint32_t>& max_queued);
+
+   /// Fails while the receiver still has queued messages, see processq and dropmsg
    [[eosio::action]] void bridgeunreg(eosio::name receiver);
 
+   /**
+    * @brief Deliver the queued (non-atomic) bridge messages of a receiver to its handler, oldest first
+    *
+    * Each receiver has its own queue, a handler that keeps failing only holds up the messages of its receiver.
+    * Requires the authority of the receiver or of the contract.
+    *
+    * @param receiver Receiver whose queue is processed
+    * @param max Maximum number of messages delivered by this call
+    * @return true if the queue of the receiver is empty
+    */
+   [[eosio::action]] bool processq(eosio::name receiver, uint32_t max);
+
+   /**
+    * @brief Remove a queued bridge message without delivering it
+    *
+    * Lets a receiver skip a message its handler cannot process. The value of the message was credited to the
+    * receiver when it was queued and is kept.
+    *
+    * @param receiver Receiver of the message, must authorize
+    * @param id Row of the message in the queue of the receiver
+    */
+   [[eosio::action]] void dropmsg(eosio::name receiver, uint64_t id);
+
    [[eosio::action]] void assertnonce(eosio::name account, uint64_t next_nonce);
 
    [[eosio::action]] void setversion(uint64_t version);
 
+   /**
+    * @brief Set the garbage collection budget
+    *
+    * @param budget Maximum number of rows of destroyed accounts erased at the end of every pushtx, pushtxs and call
+    * (in addition to the explicit gc action). Zero disables automatic garbage collection.
+    */
+   [[eosio::action]] void setgcbudget(uint32_t budget);
+
    // Events
    [[eosio::action]] void evmtx(eosio::ignore<evm_runtime::evmtx_type> event){
       eosio::check(get_sender() == get_self(), "forbidden to call");
@@ -111,6 +237,7 @@ public:
    [[eosio::action]] void dumpall();
    [[eosio::action]] void setbal(const bytes& addy, const bytes& bal);
    [[eosio::action]] void testbaldust(const name test);
+   [[eosio::action]] void mklegacy(uint64_t id);
 #endif
 
 private:
@@ -125,22 +252,52 @@ private:
    void assert_inited();
    void assert_unfrozen();
 
-   silkworm::Receipt execute_tx(const runtime_config& rc, eosio::name miner, silkworm::Block& block, const transaction& tx, silkworm::ExecutionProcessor& ep);
+   struct block_context {
+      uint64_t                     evm_block_num = 0;
+      uint64_t                     evm_version = 0;
+      const silkworm::ChainConfig* chain_config = nullptr;
+      silkworm::BlockHeader        header;
+   };
+
+   // Chain config and header of the current EVM block. The contract instance lives
+   // for a single action, so this is shared by the transactions of one action.
+   std::optional<block_context> _block_context;
+   const block_context& get_block_context(uint64_t evm_version);
+
+   // Set by pushtx, pushtxs and call, the only actions that return the tx_stats of
+   // their transactions when built WITH_TX_STATS (deposits and admincall do not)
+   bool _report_tx_stats = false;
+
+   // Adds the miner cut of the gas fee to miner_fee, the caller credits it
+   silkworm::Receipt execute_tx(const runtime_config& rc, eosio::name miner, silkworm::Block& block, const transaction& tx, silkworm::ExecutionProcessor& ep, intx::uint256& miner_fee);
+   // Without a gas limit the call gets 0x7ffffffffff gas on top of the intrinsic gas
+   exec_output exec_input_in_block(const exec_input& input, const std::vector<state_override>& overrides,
+                                   const silkworm::Block& block, const silkworm::ChainConfig& chain_config, struct state& state,
+                                   std::optional<uint64_t> gas_limit = {});
    void process_filtered_messages(const std::vector<silkworm::FilteredMessage>& filtered_messages);
+   // Count messages removed from the queue of a receiver
+   void release_queued(eosio::name receiver, uint32_t count);
 
-   uint64_t get_and_increment_nonce(const name owner);
+   uint64_t get_and_increment_nonce(const name owner, uint64_t count = 1);
 
    checksum256 get_code_hash(name account) const;
 
    void handle_account_transfer(const eosio::asset& quantity, const std::string& memo);
    void handle_evm_transfer(eosio::asset quantity, const std::string& memo);
 
+   intx::uint256 get_ingress_value(eosio::asset quantity) const;
+   silkworm::Transaction make_deposit_tx(uint64_t nonce, const evmc::address& to, const intx::uint256& value) const;
+   // Deposits to accounts without code are credited directly, with the same effects
+   // as executing their bridge transactions. The others go through the EVM as one batch.
+   void process_deposits(std::vector<silkworm::Transaction> txns);
+
    void call_(const runtime_config& rc, intx::uint256 s, const bytes& to, intx::uint256 value, const bytes& data, uint64_t gas_limit, uint64_t nonce);
 
    using pushtx_action = eosio::action_wrapper<"pushtx"_n, &evm_contract::pushtx>;
 
-   void process_tx(const runtime_config& rc, eosio::name miner, const transaction& tx);
-   void dispatch_tx(const runtime_config& rc, const transaction& tx);
+   runtime_config get_pushtx_runtime_config() const;
+   void process_txs(const runtime_config& rc, eosio::name miner, const std::vector<transaction>& txs);
+   void dispatch_tx(const runtime_config& rc, transaction tx);
 };
 
 } // namespace evm_runtime
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <evm_runtime/intrinsics.hpp>
+
+namespace evm_runtime {
+
+// Stages of the transaction pipeline. Built WITH_LOGTIME, every scoped_stage
+// logs "EVM STAGE <stage> BEGIN" and "EVM STAGE <stage> END" through the
+// `logtime` host function, which timestamps them in the node log.
+enum class stage : uint8_t {
+   action,
+   decode,
+   recover,
+   validate,
+   execute,
+   egress,
+   write_to_db,
+   bridge_messages,
+   events // keep last, scoped_stage has one pair of messages per stage
+};
+
+#ifdef WITH_LOGTIME
+class scoped_stage {
+public:
+   explicit scoped_stage(stage s) : _stage(s) {
+      eosio::internal_use_do_not_use::logtime(messages[static_cast<uint8_t>(_stage)][0]);
+   }
+   ~scoped_stage() {
+      eosio::internal_use_do_not_use::logtime(messages[static_cast<uint8_t>(_stage)][1]);
+   }
+
+   scoped_stage(const scoped_stage&) = delete;
+   scoped_stage& operator=(const scoped_stage&) = delete;
+
+private:
+   static constexpr const char* messages[][2] = {
+      {"EVM STAGE action BEGIN",          "EVM STAGE action END"},
+      {"EVM STAGE decode BEGIN",          "EVM STAGE decode END"},
+      {"EVM STAGE recover BEGIN",         "EVM STAGE recover END"},
+      {"EVM STAGE validate BEGIN",        "EVM STAGE validate END"},
+      {"EVM STAGE execute BEGIN",         "EVM STAGE execute END"},
+      {"EVM STAGE egress BEGIN",          "EVM STAGE egress END"},
+      {"EVM STAGE write_to_db BEGIN",     "EVM STAGE write_to_db END"},
+      {"EVM STAGE bridge_messages BEGIN", "EVM STAGE bridge_messages END"},
+      {"EVM STAGE events BEGIN",          "EVM STAGE events END"},
+   };
+   static_assert(sizeof(messages) / sizeof(messages[0]) == static_cast<uint8_t>(stage::events) + 1,
+                 "one pair of messages per stage");
+
+   stage _stage;
+};
+#else
+class scoped_stage {
+public:
+   explicit scoped_stage(stage) {}
+};
+#endif
+
+} // namespace evm_runtime
@@ -4,6 +4,7 @@
 #include <map>
 #include <eosio/eosio.hpp>
 #include <evm_runtime/types.hpp>
+#include <evm_runtime/tables.hpp>
 #include <silkworm/core/state/state.hpp>
 
 namespace evm_runtime {
@@ -16,11 +17,31 @@ struct table_stats {
     uint32_t update=0;
     uint32_t create=0;
     uint32_t remove=0;
+
+    EOSLIB_SERIALIZE(table_stats, (read)(update)(create)(remove));
 };
 
 struct db_stats {
     table_stats account;
     table_stats storage;
+    table_stats code;
+    uint32_t    code_cache_hits=0;
+
+    EOSLIB_SERIALIZE(db_stats, (account)(storage)(code)(code_cache_hits));
+};
+
+// Reported per transaction when built with WITH_TX_STATS
+struct tx_stats {
+    uint64_t gas_used=0;
+    db_stats db;
+
+    EOSLIB_SERIALIZE(tx_stats, (gas_used)(db));
+};
+
+struct account_writes {
+    std::optional<std::pair<std::optional<Account>, std::optional<Account>>> account;
+    std::optional<std::pair<evmc::bytes32, bytes>> code;
+    std::map<evmc::bytes32, evmc::bytes32> storage;
 };
 
 struct state : State {
@@ -28,14 +49,28 @@ struct state : State {
     name _ram_payer;
     bool _read_only;
     bool _allow_frozen;
-    mutable std::map<evmc::address, uint64_t> addr2id;
-    mutable std::map<bytes32, bytes> addr2code;
+    mutable account_table _accounts;
+    mutable account_code_table _codes;
+    // Rows of _accounts shared by the read and write paths (nullptr if the address has no account)
+    mutable std::map<evmc::address, const account*> addr2account;
+    // Rows of _codes by code hash, code is handed out as a view into the row
+    mutable std::map<bytes32, const account_code*> addr2code;
     mutable db_stats stats;
     std::optional<config2> _config2;
 
-    explicit state(name self, name ram_payer, bool read_only=false, bool allow_frozen=true) : _self(self), _ram_payer(ram_payer), _read_only{read_only}, _allow_frozen{allow_frozen}{}
+    // Updates coming from IntraBlockState::write_to_db are buffered here and
+    // written to the chain tables by flush(), resolving each address only once.
+    std::map<evmc::address, account_writes> _pending;
+    std::vector<evmc::address> _pending_storage_order;
+    std::vector<evmc::address> _pending_account_order;
+
+    explicit state(name self, name ram_payer, bool read_only=false, bool allow_frozen=true) : _self(self), _ram_payer(ram_payer), _read_only{read_only}, _allow_frozen{allow_frozen}, _accounts(self, self.value), _codes(self, self.value){}
     virtual ~state() override;
 
+    const account* find_account(const evmc::address& address) const;
+
+    config2& get_config2();
+
     uint64_t get_next_account_id();
 
     std::optional<Account> read_account(const evmc::address& address) const noexcept override;
@@ -78,6 +113,14 @@ struct state : State {
     /// @return true if all garbage has been collected
     bool gc(uint32_t max);
 
+    /// Erase the storage rows of gcstore row `id` with primary keys in [lower, upper]
+    /// @return true if no row is left in that range
+    bool gc_range(uint64_t id, uint64_t lower, uint64_t upper, uint32_t max);
+
+    /// Move rows of the legacy storage table into storage2
+    /// @return true if all accounts have been migrated
+    bool migrate_storage(uint32_t max);
+
     void update_account_code(const evmc::address& address, uint64_t incarnation, const evmc::bytes32& code_hash,
                              ByteView code) override;
 
@@ -85,6 +128,84 @@ struct state : State {
                         const evmc::bytes32& initial, const evmc::bytes32& current) override;
 
     void unwind_state_changes(uint64_t block_number) override;
+
+    /// Write all buffered account, code and storage updates to the chain tables
+    void flush();
+};
+
+// Read-only view of a state with the state overrides of exec applied. The
+// overridden accounts, code and slots are what the state holds, so the EVM
+// sees them as committed values (e.g. for SSTORE gas and refunds). Writes are
+// dropped, exec never persists anything.
+struct overlay_state : State {
+    overlay_state(const State& base, const std::vector<state_override>& overrides);
+
+    std::optional<Account> read_account(const evmc::address& address) const noexcept override;
+
+    ByteView read_code(const evmc::bytes32& code_hash) const noexcept override;
+
+    evmc::bytes32 read_storage(const evmc::address& address, uint64_t incarnation,
+                               const evmc::bytes32& location) const noexcept override;
+
+    uint64_t previous_incarnation(const evmc::address& address) const noexcept override {
+        return _base.previous_incarnation(address);
+    }
+
+    std::optional<BlockHeader> read_header(uint64_t block_number,
+                                           const evmc::bytes32& block_hash) const noexcept override {
+        return _base.read_header(block_number, block_hash);
+    }
+
+    bool read_body(BlockNum block_number, const evmc::bytes32& block_hash,
+                                            BlockBody& out) const noexcept override {
+        return _base.read_body(block_number, block_hash, out);
+    }
+
+    std::optional<intx::uint256> total_difficulty(uint64_t block_number,
+                                                  const evmc::bytes32& block_hash) const noexcept override {
+        return _base.total_difficulty(block_number, block_hash);
+    }
+
+    evmc::bytes32 state_root_hash() const override { return _base.state_root_hash(); }
+
+    uint64_t current_canonical_block() const override { return _base.current_canonical_block(); }
+
+    std::optional<evmc::bytes32> canonical_hash(uint64_t block_number) const override {
+        return _base.canonical_hash(block_number);
+    }
+
+    void insert_block(const Block& block, const evmc::bytes32& hash) override {}
+
+    void canonize_block(uint64_t block_number, const evmc::bytes32& block_hash) override {}
+
+    void decanonize_block(uint64_t block_number) override {}
+
+    void insert_receipts(uint64_t block_number, const std::vector<Receipt>& receipts) override {}
+
+    void begin_block(uint64_t block_number) override {}
+
+    void update_account(const evmc::address& address, std::optional<Account> initial,
+                        std::optional<Account> current) override {}
+
+    void update_account_code(const evmc::address& address, uint64_t incarnation, const evmc::bytes32& code_hash,
+                             ByteView code) override {}
+
+    void update_storage(const evmc::address& address, uint64_t incarnation, const evmc::bytes32& location,
+                        const evmc::bytes32& initial, const evmc::bytes32& current) override {}
+
+    void unwind_state_changes(uint64_t block_number) override {}
+
+private:
+    struct account_override {
+        std::optional<intx::uint256> balance;
+        std::optional<uint64_t>      nonce;
+        std::optional<evmc::bytes32> code_hash;
+    };
+
+    const State& _base;
+    std::map<evmc::address, account_override> _accounts;
+    std::map<evmc::bytes32, Bytes> _codes;
+    std::map<std::pair<evmc::address, evmc::bytes32>, evmc::bytes32> _storage;
 };
 
 }  // namespace evm_runtime
@@ -15,7 +15,8 @@ namespace evm_runtime {
 using namespace eosio;
 struct [[eosio::table]] [[eosio::contract("evm_contract")]] account {
     enum class flag : uint32_t {
-        frozen = 0x1
+        frozen = 0x1,
+        storage_v2 = 0x2 // all storage slots of this account live in the storage2 table
     };
 
     uint64_t    id;
@@ -24,6 +25,7 @@ struct [[eosio::table]] [[eosio::contract("evm_contract")]] account {
     bytes       balance;
     std::optional<uint64_t> code_id;
     binary_extension<uint32_t> flags=0;
+    binary_extension<checksum256> code_hash; // hash of the code_id row, so reading the account does not load the code
 
     void set_flag(flag f) {
         flags.value() |= static_cast<uint32_t>(f);
@@ -34,7 +36,7 @@ struct [[eosio::table]] [[eosio::contract("evm_contract")]] account {
     }
 
     inline bool has_flag(flag f)const {
-        return (flags.value() & static_cast<uint32_t>(f) != 0);
+        return (flags.value() & static_cast<uint32_t>(f)) != 0;
     }
 
     uint64_t primary_key()const { return id; }
@@ -49,7 +51,7 @@ struct [[eosio::table]] [[eosio::contract("evm_contract")]] account {
         return res;
     }
 
-    EOSLIB_SERIALIZE(account, (id)(eth_address)(nonce)(balance)(code_id)(flags));
+    EOSLIB_SERIALIZE(account, (id)(eth_address)(nonce)(balance)(code_id)(flags)(code_hash));
 };
 
 typedef multi_index< "account"_n, account,
@@ -97,6 +99,34 @@ typedef multi_index< "storage"_n, storage,
     indexed_by<"by.key"_n, const_mem_fun<storage, checksum256, &storage::by_key>> 
 > storage_table;
 
+// Fixed-width storage row, replaces `storage` for accounts flagged with account::flag::storage_v2.
+// The primary key is derived from the slot (see storage2_key), a row with a zero value is a tombstone.
+struct [[eosio::table]] [[eosio::contract("evm_contract")]] storage2 {
+    uint64_t    id;
+    checksum256 key;
+    checksum256 value;
+
+    uint64_t primary_key()const { return id; }
+
+    bool is_tombstone()const { return value == checksum256(); }
+
+    EOSLIB_SERIALIZE(storage2, (id)(key)(value));
+};
+
+typedef multi_index< "storage2"_n, storage2> storage2_table;
+
+/// Home primary key of a slot (mix of its four words), collisions probe the following keys (linear probing)
+uint64_t storage2_key(const checksum256& key);
+
+/// @return the row holding `key` (possibly a tombstone) or end()
+storage2_table::const_iterator storage2_find(const storage2_table& db, const checksum256& key);
+
+/// Insert a slot that is known not to be in the table, reusing the first tombstone on its probe chain
+void storage2_insert(storage2_table& db, name payer, const checksum256& key, const checksum256& value);
+
+/// Remove a slot, leaving a tombstone behind if a probe chain may run through it
+void storage2_erase(storage2_table& db, storage2_table::const_iterator itr);
+
 struct [[eosio::table]] [[eosio::contract("evm_contract")]] gcstore {
     uint64_t id;
     uint64_t storage_id;
@@ -213,22 +243,39 @@ struct [[eosio::table]] [[eosio::contract("evm_contract")]] message_receiver {
     name     handler;
     asset    min_fee;
     uint32_t flags;
+    binary_extension<uint32_t> max_queued = 0; // queued (non-atomic) messages accepted at once, 0 rejects them
+    binary_extension<uint32_t> queued = 0;     // rows in the msgqueue scope of the receiver
 
     uint64_t primary_key() const { return account.value; }
     bool has_flag(flag f) const {
         return (flags & f) != 0;
     }
 
-    EOSLIB_SERIALIZE(message_receiver, (account)(handler)(min_fee)(flags));
+    EOSLIB_SERIALIZE(message_receiver, (account)(handler)(min_fee)(flags)(max_queued)(queued));
 };
 
 typedef eosio::multi_index<"msgreceiver"_n, message_receiver> message_receiver_table;
 
+// Bridge messages sent with non-atomic delivery, scoped by receiver, oldest first.
+// The value of the message is credited to the receiver when it is queued.
+struct [[eosio::table]] [[eosio::contract("evm_contract")]] queued_message {
+    uint64_t       id;
+    name           handler;
+    bridge_message message;
+
+    uint64_t primary_key() const { return id; }
+
+    EOSLIB_SERIALIZE(queued_message, (id)(handler)(message));
+};
+
+typedef eosio::multi_index<"msgqueue"_n, queued_message> message_queue_table;
+
 struct [[eosio::table]] [[eosio::contract("evm_contract")]] config2
 {
     uint64_t next_account_id{0};
+    binary_extension<uint64_t> next_migrate_account_id; // account cursor of migstorage
 
-    EOSLIB_SERIALIZE(config2, (next_account_id));
+    EOSLIB_SERIALIZE(config2, (next_account_id)(next_migrate_account_id));
 };
 
 struct evm_version_type {
@@ -283,8 +330,9 @@ struct [[eosio::table]] [[eosio::contract("evm_contract")]] config
     uint32_t miner_cut = 0;
     uint32_t status = 0; // <- bit mask values from status_flags
     binary_extension<evm_version_type> evm_version;
+    binary_extension<uint32_t> gc_budget; // max rows collected at the end of each pushtx/call (0 disables)
 
-    EOSLIB_SERIALIZE(config, (version)(chainid)(genesis_time)(ingress_bridge_fee)(gas_price)(miner_cut)(status)(evm_version));
+    EOSLIB_SERIALIZE(config, (version)(chainid)(genesis_time)(ingress_bridge_fee)(gas_price)(miner_cut)(status)(evm_version)(gc_budget));
 };
 
 } //namespace evm_runtime
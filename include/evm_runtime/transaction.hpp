@@ -31,19 +31,14 @@ struct transaction {
     if(!tx_) {
       eosio::check(rlptx_.has_value(), "no rlptx");
       ByteView bv{(const uint8_t*)rlptx_->data(), rlptx_->size()};
-      silkworm::Transaction tmp;
+      // decode in place, a failure aborts the action anyway
+      auto& tmp = tx_.emplace();
       eosio::check(silkworm::rlp::decode(bv, tmp) && bv.empty(), "unable to decode transaction");
-      tx_.emplace(tmp);
     }
     return tx_.value();
   }
 
-  void recover_sender()const {
-    eosio::check(tx_.has_value(), "no tx");
-    auto& tx = tx_.value();
-    tx.from.reset();
-    tx.recover_sender();
-  }
+  void recover_sender()const;
 
 private:
   mutable std::optional<bytes>  rlptx_;
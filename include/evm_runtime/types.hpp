@@ -4,6 +4,7 @@
 #include <eosio/name.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/symbol.hpp>
+#include <eosio/binary_extension.hpp>
 #include <intx/intx.hpp>
 #include <evmc/evmc.hpp>
 #include <ethash/hash_types.hpp>
@@ -38,6 +39,7 @@ namespace evm_runtime {
 
    evmc::address to_address(const bytes& addr);
    evmc::bytes32 to_bytes32(const bytes& data);
+   evmc::bytes32 to_bytes32(const eosio::checksum256& data);
    uint256 to_uint256(const bytes& value);
 
    struct exec_input {
@@ -58,11 +60,38 @@ namespace evm_runtime {
    };
 
    struct exec_output {
-      int32_t              status;
-      bytes                data;
-      std::optional<bytes> context;
+      int32_t                          status;
+      bytes                            data;
+      std::optional<bytes>             context;
+      eosio::binary_extension<uint64_t> gas_used; ///< Intrinsic gas plus the gas consumed by the call, before refunds
+
+      EOSLIB_SERIALIZE(exec_output, (status)(data)(context)(gas_used));
+   };
+
+   struct storage_override {
+      bytes key;   ///< 32 bytes
+      bytes value; ///< 32 bytes
+
+      EOSLIB_SERIALIZE(storage_override, (key)(value));
+   };
+
+   /// Replaces parts of an account for the duration of a read-only call. Slots not listed in `storage` keep
+   /// their current value.
+   struct state_override {
+      bytes                         address;
+      std::optional<bytes>          balance; ///< Big endian, up to 32 bytes
+      std::optional<uint64_t>       nonce;
+      std::optional<bytes>          code;
+      std::vector<storage_override> storage;
+
+      EOSLIB_SERIALIZE(state_override, (address)(balance)(nonce)(code)(storage));
+   };
+
+   struct deposit_entry {
+      bytes        to;
+      eosio::asset quantity;
 
-      EOSLIB_SERIALIZE(exec_output, (status)(data)(context));
+      EOSLIB_SERIALIZE(deposit_entry, (to)(quantity));
    };
 
    struct bridge_message_v0 {
@@ -106,9 +135,9 @@ namespace eosio {
 
 template<typename Stream>
 inline datastream<Stream>& operator>>(datastream<Stream>& ds, evm_runtime::uint256& v) {
-   evm_runtime::bytes buffer(32,0);
-   ds.read((char*)buffer.data(), 32);
-   v = intx::be::unsafe::load<evm_runtime::uint256>((const uint8_t *)buffer.data());
+   uint8_t buffer[32];
+   ds.read((char*)buffer, sizeof(buffer));
+   v = intx::be::unsafe::load<evm_runtime::uint256>(buffer);
    return ds;
 }
 
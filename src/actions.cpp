@@ -9,17 +9,13 @@
 #include <evm_runtime/eosio.token.hpp>
 #include <evm_runtime/bridge.hpp>
 #include <evm_runtime/config_wrapper.hpp>
+#include <evm_runtime/stage_timer.hpp>
 
 #include <silkworm/core/protocol/trust_rule_set.hpp>
+#include <silkworm/core/protocol/intrinsic_gas.hpp>
 // included here so NDEBUG is defined to disable assert macro
 #include <silkworm/core/execution/processor.hpp>
 
-#ifdef WITH_LOGTIME
-#define LOGTIME(MSG) eosio::internal_use_do_not_use::logtime(MSG)
-#else
-#define LOGTIME(MSG)
-#endif
-
 extern "C" {
 __attribute__((eosio_wasm_import))
 void set_action_return_value(void*, size_t);
@@ -34,6 +30,9 @@ namespace silkworm {
 namespace evm_runtime {
 
 static constexpr char err_msg_invalid_addr[] = "invalid address";
+static const std::vector<state_override> no_overrides;
+// Gas limit of estimategas attempts known to succeed
+static constexpr uint64_t max_estimate_gas_limit = 0x7ffffffffff;
 
 using namespace silkworm;
 
@@ -174,7 +173,7 @@ void check_result( ValidationResult r, const Transaction& txn, const char* desc
     eosio::check( false, std::move(err_msg));
 }
 
-Receipt evm_contract::execute_tx(const runtime_config& rc, eosio::name miner, Block& block, const transaction& txn, silkworm::ExecutionProcessor& ep) {
+Receipt evm_contract::execute_tx(const runtime_config& rc, eosio::name miner, Block& block, const transaction& txn, silkworm::ExecutionProcessor& ep, intx::uint256& miner_fee) {
     const auto& tx = txn.get_tx();
     balances balance_table(get_self(), get_self().value);
 
@@ -183,11 +182,6 @@ Receipt evm_contract::execute_tx(const runtime_config& rc, eosio::name miner, Bl
         miner = {};
     }
 
-    if (miner) {
-        // Ensure the miner has a balance open early.
-        balance_table.get(miner.value, "no balance open for miner");
-    }
-
     bool deducted_miner_cut = false;
 
     std::optional<inevm_singleton> inevm;
@@ -199,9 +193,11 @@ Receipt evm_contract::execute_tx(const runtime_config& rc, eosio::name miner, Bl
 
     bool is_special_signature = silkworm::is_special_signature(tx.r, tx.s);
 
-    txn.recover_sender();
+    {
+        scoped_stage timer{stage::recover};
+        txn.recover_sender();
+    }
     eosio::check(tx.from.has_value(), "unable to recover sender");
-    LOGTIME("EVM RECOVER SENDER");
 
     // 1 For regular signature, it's impossible to from reserved address, 
     // and now we accpet them regardless from self or not, so no special treatment.
@@ -233,14 +229,20 @@ Receipt evm_contract::execute_tx(const runtime_config& rc, eosio::name miner, Bl
         check(tx.chain_id.has_value(), "tx without chain-id");
     }
 
-    ValidationResult r = silkworm::protocol::pre_validate_transaction(tx, ep.evm().revision(), ep.evm().config().chain_id,
-                                                             ep.evm().block().header.base_fee_per_gas, ep.evm().block().header.data_gas_price());
-    check_result( r, tx, "pre_validate_transaction error" );
-    r = silkworm::protocol::validate_transaction(tx, ep.state(), ep.available_gas());
-    check_result( r, tx, "validate_transaction error" );
+    {
+        scoped_stage timer{stage::validate};
+        ValidationResult r = silkworm::protocol::pre_validate_transaction(tx, ep.evm().revision(), ep.evm().config().chain_id,
+                                                                 ep.evm().block().header.base_fee_per_gas, ep.evm().block().header.data_gas_price());
+        check_result( r, tx, "pre_validate_transaction error" );
+        r = silkworm::protocol::validate_transaction(tx, ep.state(), ep.available_gas());
+        check_result( r, tx, "validate_transaction error" );
+    }
 
     Receipt receipt;
-    ep.execute_transaction(tx, receipt);
+    {
+        scoped_stage timer{stage::execute};
+        ep.execute_transaction(tx, receipt);
+    }
 
     // Calculate the miner portion of the actual gas fee (if necessary):
     std::optional<intx::uint256> gas_fee_miner_portion;
@@ -257,6 +259,7 @@ Receipt evm_contract::execute_tx(const runtime_config& rc, eosio::name miner, Bl
         eosio::check(receipt.success, "tx executed inline by contract must succeed");
 
     if(!ep.state().reserved_objects().empty()) {
+        scoped_stage timer{stage::egress};
         bool non_open_account_sent = false;
         intx::uint256 total_egress;
         populate_bridge_accessors();
@@ -305,35 +308,24 @@ Receipt evm_contract::execute_tx(const runtime_config& rc, eosio::name miner, Bl
             inevm->set(inevm->get() -= total_egress, eosio::same_payer);
     }
 
-    // Send miner portion of the gas fee, if any, to the balance of the miner:
+    // The miner portion of the gas fee, if any, is credited by the caller
     if (gas_fee_miner_portion.has_value() && *gas_fee_miner_portion != 0) {
         check(deducted_miner_cut, "unexpected error: contract account did not receive any funds through its reserved address");
-        balance_table.modify(balance_table.get(miner.value), eosio::same_payer, [&](balance& b){
-            b.balance += *gas_fee_miner_portion;
-        });
+        miner_fee += *gas_fee_miner_portion;
     }
 
-    LOGTIME("EVM EXECUTE");
     return receipt;
 }
 
-void evm_contract::exec(const exec_input& input, const std::optional<exec_callback>& callback) {
-
-    assert_unfrozen();
-
-    std::optional<std::pair<const std::string, const ChainConfig*>> found_chain_config = lookup_known_chain(_config->get_chainid());
-    check( found_chain_config.has_value(), "failed to find expected chain config" );
-
-    eosevm::block_mapping bm(_config->get_genesis_time().sec_since_epoch());
-
-    Block block;
-    eosevm::prepare_block_header(block.header, bm, get_self().value,
-        bm.timestamp_to_evm_block_num(eosio::current_time_point().time_since_epoch().count()), _config->get_evm_version());
-
-    evm_runtime::state state{get_self(), get_self(), true};
-    IntraBlockState ibstate{state};
+exec_output evm_contract::exec_input_in_block(const exec_input& input, const std::vector<state_override>& overrides,
+                                              const Block& block, const ChainConfig& chain_config, evm_runtime::state& state,
+                                              std::optional<uint64_t> gas_limit) {
+    // Inputs share the state (and its row caches) but never see each other's changes.
+    // The overrides only live for this call, in a view over the state.
+    overlay_state overlay{state, overrides};
+    IntraBlockState ibstate{overlay};
 
-    EVM evm{block, ibstate, *found_chain_config.value().second};
+    EVM evm{block, ibstate, chain_config};
 
     Transaction txn;
     txn.to    = to_address(input.to);
@@ -341,13 +333,41 @@ void evm_contract::exec(const exec_input& input, const std::optional<exec_callba
     txn.from  = input.from.has_value()  ? to_address(input.from.value()) : evmc::address{};
     txn.value = input.value.has_value() ? to_uint256(input.value.value()) : 0;
 
-    const CallResult vm_res{evm.execute(txn, 0x7ffffffffff)};
+    const auto intrinsic = static_cast<uint64_t>(silkworm::protocol::intrinsic_gas(txn, evm.revision()));
+    if(gas_limit.has_value() && *gas_limit < intrinsic) {
+        exec_output output{
+            .status  = int32_t(EVMC_OUT_OF_GAS),
+            .context = input.context
+        };
+        output.gas_used.emplace(*gas_limit);
+        return output;
+    }
+
+    const uint64_t gas = gas_limit.has_value() ? *gas_limit - intrinsic : 0x7ffffffffff;
+    const CallResult vm_res{evm.execute(txn, gas)};
 
     exec_output output{
         .status  = int32_t(vm_res.status),
         .data    = bytes{vm_res.data.begin(), vm_res.data.end()},
         .context = input.context
     };
+    output.gas_used.emplace(intrinsic + gas - vm_res.gas_left);
+    return output;
+}
+
+void evm_contract::exec(const exec_input& input, const std::optional<exec_callback>& callback,
+                        const eosio::binary_extension<std::vector<state_override>>& overrides) {
+
+    assert_unfrozen();
+
+    const auto& ctx = get_block_context(_config->get_evm_version());
+
+    Block block;
+    block.header = ctx.header;
+
+    evm_runtime::state state{get_self(), get_self(), true};
+
+    exec_output output = exec_input_in_block(input, overrides.has_value() ? overrides.value() : no_overrides, block, *ctx.chain_config, state);
 
     if(callback.has_value()) {
         const auto& cb = callback.value();
@@ -359,52 +379,213 @@ void evm_contract::exec(const exec_input& input, const std::optional<exec_callba
     }
 }
 
+void evm_contract::execbatch(const std::vector<exec_input>& inputs,
+                             const eosio::binary_extension<std::vector<state_override>>& overrides) {
+
+    assert_unfrozen();
+    eosio::check(!inputs.empty(), "no inputs");
+
+    const auto& ctx = get_block_context(_config->get_evm_version());
+
+    Block block;
+    block.header = ctx.header;
+
+    evm_runtime::state state{get_self(), get_self(), true};
+
+    std::vector<exec_output> outputs;
+    outputs.reserve(inputs.size());
+    for(const auto& input : inputs) {
+        outputs.push_back(exec_input_in_block(input, overrides.has_value() ? overrides.value() : no_overrides, block, *ctx.chain_config, state));
+    }
+
+    auto outputs_bin = eosio::pack(outputs);
+    set_action_return_value(outputs_bin.data(), outputs_bin.size());
+}
+
+void evm_contract::estimategas(const exec_input& input, const eosio::binary_extension<std::vector<state_override>>& overrides) {
+
+    assert_unfrozen();
+
+    const auto& ctx = get_block_context(_config->get_evm_version());
+
+    Block block;
+    block.header = ctx.header;
+
+    // Every attempt reads through the same state, only the first one loads rows
+    evm_runtime::state state{get_self(), get_self(), true};
+    const auto& call_overrides = overrides.has_value() ? overrides.value() : no_overrides;
+
+    auto succeeds = [&](uint64_t gas_limit) {
+        return exec_input_in_block(input, call_overrides, block, *ctx.chain_config, state, gas_limit).status == EVMC_SUCCESS;
+    };
+
+    // The first run uses the upper bound of the search, so the limit returned always succeeded
+    exec_output output = exec_input_in_block(input, call_overrides, block, *ctx.chain_config, state, max_estimate_gas_limit);
+    if(output.status == EVMC_SUCCESS) {
+        // A limit below the gas used always fails. Most calls succeed with exactly
+        // that much, otherwise the 63/64 rule of nested calls asks for a bit more.
+        uint64_t lo = output.gas_used.value() - 1;
+        uint64_t hi = max_estimate_gas_limit;
+        for(uint64_t guess : {output.gas_used.value(), output.gas_used.value() * 64 / 63 + 2300}) {
+            if(guess <= lo || guess >= hi) continue;
+            if(succeeds(guess)) {
+                hi = guess;
+                break;
+            }
+            lo = guess;
+        }
+        while(lo + 1 < hi) {
+            const uint64_t mid = lo + (hi - lo) / 2;
+            if(succeeds(mid))
+                hi = mid;
+            else
+                lo = mid;
+        }
+        output.gas_used.emplace(hi);
+    }
+
+    auto output_bin = eosio::pack(output);
+    set_action_return_value(output_bin.data(), output_bin.size());
+}
+
+const evm_contract::block_context& evm_contract::get_block_context(uint64_t evm_version) {
+    eosevm::block_mapping bm(_config->get_genesis_time().sec_since_epoch());
+    const uint64_t evm_block_num = bm.timestamp_to_evm_block_num(eosio::current_time_point().time_since_epoch().count());
+
+    if (!_block_context || _block_context->evm_block_num != evm_block_num || _block_context->evm_version != evm_version) {
+        std::optional<std::pair<const std::string, const ChainConfig*>> found_chain_config = lookup_known_chain(_config->get_chainid());
+        check( found_chain_config.has_value(), "failed to find expected chain config" );
+
+        auto& ctx = _block_context.emplace();
+        ctx.evm_block_num = evm_block_num;
+        ctx.evm_version = evm_version;
+        ctx.chain_config = found_chain_config->second;
+        eosevm::prepare_block_header(ctx.header, bm, get_self().value, evm_block_num, evm_version);
+    }
+
+    return *_block_context;
+}
+
 void evm_contract::process_filtered_messages(const std::vector<silkworm::FilteredMessage>& filtered_messages ) {
+    scoped_stage timer{stage::bridge_messages};
 
-    intx::uint256 accumulated_value;
-    for(const auto& rawmsg : filtered_messages) {
-        auto msg = bridge::decode_message(ByteView{rawmsg.data});
-        eosio::check(msg.has_value(), "unable to decode bridge message");
+    if(filtered_messages.empty())
+        return;
+
+    message_receiver_table message_receivers(get_self(), get_self().value);
+    balances balance_table(get_self(), get_self().value);
 
-        auto& msg_v0 = std::get<bridge::message_v0>(msg.value());
+    // Receivers are looked up on their first message, their balance rows are
+    // credited once all the messages are sent (handlers run after this action)
+    struct receiver_entry {
+        const message_receiver* receiver;
+        const balance*          account;
+        intx::uint256           min_fee;
+        intx::uint256           value;
+        uint32_t                queued = 0;
+    };
+    std::vector<std::pair<uint64_t, receiver_entry>> receivers;
 
-        const auto& receiver = msg_v0.get_account_as_name();
-        eosio::check(eosio::is_account(receiver), "receiver is not account");
+    auto get_receiver = [&](const name& receiver) -> receiver_entry& {
+        auto entry = std::find_if(receivers.begin(), receivers.end(), [&](const auto& e) { return e.first == receiver.value; });
+        if(entry == receivers.end()) {
+            eosio::check(eosio::is_account(receiver), "receiver is not account");
 
-        message_receiver_table message_receivers(get_self(), get_self().value);
-        auto it = message_receivers.find(receiver.value);
-        eosio::check(it != message_receivers.end(), "receiver not registered");
+            auto it = message_receivers.find(receiver.value);
+            eosio::check(it != message_receivers.end(), "receiver not registered");
 
-        eosio::check(msg_v0.force_atomic == false || it->has_flag(message_receiver::FORCE_ATOMIC), "unable to process message");
+            intx::uint256 min_fee((uint64_t)it->min_fee.amount);
+            min_fee *= minimum_natively_representable;
 
-        intx::uint256 min_fee((uint64_t)it->min_fee.amount);
-        min_fee *= minimum_natively_representable;
+            receivers.emplace_back(receiver.value, receiver_entry{&*it, nullptr, min_fee, 0});
+            entry = std::prev(receivers.end());
+        }
+        return entry->second;
+    };
 
-        auto value = intx::be::unsafe::load<uint256>(rawmsg.value.bytes);
-        eosio::check(value >= min_fee, "min_fee not covered");
+    // Sends the message to the handler right away, or queues it for processq
+    intx::uint256 accumulated_value;
+    auto deliver = [&](receiver_entry& r, const silkworm::FilteredMessage& rawmsg, const bridge::account_string& to,
+                       const intx::uint256& value, const bytes& data, bool atomic) {
+        eosio::check(value >= r.min_fee, "min_fee not covered");
 
-        balances balance_table(get_self(), get_self().value);
-        const balance& receiver_account = balance_table.get(receiver.value, "receiver account is not open");
-
-        action(std::vector<permission_level>{}, it->handler, "onbridgemsg"_n,
-            bridge_message{ bridge_message_v0 {
-                .receiver  = msg_v0.get_account_as_name(),
-                .sender    = to_bytes(rawmsg.sender),
-                .timestamp = eosio::current_time_point(),
-                .value     = to_bytes(rawmsg.value),
-                .data      = msg_v0.data
-            } }
-        ).send();
+        const auto& receiver = to.get_account_as_name();
+        if(!r.account) {
+            r.account = &balance_table.get(receiver.value, "receiver account is not open");
+        }
 
-        balance_table.modify(receiver_account, eosio::same_payer, [&](balance& row) {
-            row.balance += value;
-        });
+        bridge_message message{ bridge_message_v0 {
+            .receiver  = receiver,
+            .sender    = to_bytes(rawmsg.sender),
+            .timestamp = eosio::current_time_point(),
+            .value     = to_bytes(value),
+            .data      = data
+        } };
+
+        if(atomic) {
+            action(std::vector<permission_level>{}, r.receiver->handler, "onbridgemsg"_n, message).send();
+        } else {
+            // The contract pays the RAM of the queue, up to the bound agreed on at registration
+            eosio::check(r.receiver->max_queued.value() > 0, "receiver does not accept queued messages");
+            eosio::check(r.receiver->queued.value() + r.queued < r.receiver->max_queued.value(), "receiver queue is full");
+            ++r.queued;
+
+            message_queue_table queue(get_self(), receiver.value);
+            queue.emplace(get_self(), [&](queued_message& row) {
+                row.id      = queue.available_primary_key();
+                row.handler = r.receiver->handler;
+                row.message = std::move(message);
+            });
+        }
 
+        r.value += value;
         accumulated_value += value;
+    };
+
+    for(const auto& rawmsg : filtered_messages) {
+        auto msg = bridge::decode_message(ByteView{rawmsg.data});
+        eosio::check(msg.has_value(), "unable to decode bridge message");
+
+        auto value = intx::be::unsafe::load<uint256>(rawmsg.value.bytes);
+
+        if(auto* msg_v0 = std::get_if<bridge::message_v0>(&msg.value())) {
+            auto& r = get_receiver(msg_v0->get_account_as_name());
+            eosio::check(msg_v0->force_atomic == false || r.receiver->has_flag(message_receiver::FORCE_ATOMIC), "unable to process message");
+            deliver(r, rawmsg, *msg_v0, value, msg_v0->data, true);
+        } else {
+            auto& msg_v1 = std::get<bridge::message_v1>(msg.value());
+
+            // The value sent with the message is split between its entries
+            intx::uint256 total;
+            for(const auto& e : msg_v1.entries) {
+                total += e.value;
+                eosio::check(total >= e.value, "invalid message value");
+            }
+            eosio::check(total == value, "invalid message value");
+
+            for(const auto& e : msg_v1.entries) {
+                auto& r = get_receiver(e.get_account_as_name());
+                eosio::check(msg_v1.atomic == false || r.receiver->has_flag(message_receiver::FORCE_ATOMIC), "unable to process message");
+                deliver(r, rawmsg, e, e.value, e.data, msg_v1.atomic);
+            }
+        }
+    }
+
+    for(const auto& entry : receivers) {
+        const auto& r = entry.second;
+        if(r.queued > 0) {
+            message_receivers.modify(*r.receiver, eosio::same_payer, [&](message_receiver& row) {
+                row.queued = row.queued.value() + r.queued;
+            });
+        }
+        if(r.value == 0)
+            continue;
+        balance_table.modify(*r.account, eosio::same_payer, [&](balance& row) {
+            row.balance += r.value;
+        });
     }
 
     if(accumulated_value > 0) {
-        balances balance_table(get_self(), get_self().value);
         const balance& self_balance = balance_table.get(get_self().value);
         balance_table.modify(self_balance, eosio::same_payer, [&](balance& row) {
             row.balance -= accumulated_value;
@@ -413,57 +594,102 @@ void evm_contract::process_filtered_messages(const std::vector<silkworm::Filtere
 
 }
 
-void evm_contract::process_tx(const runtime_config& rc, eosio::name miner, const transaction& txn) {
-    LOGTIME("EVM START1");
-
-    const auto& tx = txn.get_tx();
+void evm_contract::process_txs(const runtime_config& rc, eosio::name miner, const std::vector<transaction>& txs) {
     eosio::check(rc.allow_non_self_miner || miner == get_self(),
                  "unexpected error: EVM contract generated inline pushtx without setting itself as the miner");
 
     auto current_version = _config->get_evm_version_and_maybe_promote();
 
-    std::optional<std::pair<const std::string, const ChainConfig*>> found_chain_config = lookup_known_chain(_config->get_chainid());
-    check( found_chain_config.has_value(), "failed to find expected chain config" );
-
-    eosevm::block_mapping bm(_config->get_genesis_time().sec_since_epoch());
+    const auto& ctx = get_block_context(current_version);
 
     Block block;
-    eosevm::prepare_block_header(block.header, bm, get_self().value,
-        bm.timestamp_to_evm_block_num(eosio::current_time_point().time_since_epoch().count()), current_version);
+    block.header = ctx.header;
 
-    silkworm::protocol::TrustRuleSet engine{*found_chain_config->second};
+    silkworm::protocol::TrustRuleSet engine{*ctx.chain_config};
 
+    // The state (and the account/code rows it caches) is shared by all the transactions
     evm_runtime::state state{get_self(), get_self(), false, false};
-    silkworm::ExecutionProcessor ep{block, engine, state, *found_chain_config->second};
 
-    check(tx.max_priority_fee_per_gas == tx.max_fee_per_gas, "max_priority_fee_per_gas must be equal to max_fee_per_gas");
-    check(tx.max_fee_per_gas >= _config->get_gas_price(), "gas price is too low");
+    // The miner cuts of all the transactions are credited at once, after the batch
+    intx::uint256 miner_fee;
+    if (miner && miner != get_self()) {
+        // Ensure the miner has a balance open early.
+        balances(get_self(), get_self().value).get(miner.value, "no balance open for miner");
+    }
+
+#ifdef WITH_TX_STATS
+    std::vector<tx_stats> stats;
+    stats.reserve(txs.size());
+#endif
 
-    // Filter EVM messages (with data) that are sent to the reserved address
-    // corresponding to the EOS account holding the contract (self)
-    ep.set_evm_message_filter([&](const evmc_message& message) -> bool {
-        static auto me = make_reserved_address(get_self().value);
-        return message.recipient == me && message.input_size > 0;
-    });
+    for(const auto& txn : txs) {
+        {
+            scoped_stage timer{stage::decode};
+            txn.get_tx();
+        }
+        const auto& tx = txn.get_tx();
+#ifdef WITH_TX_STATS
+        state.stats = {};
+#endif
+
+        // Reserved objects, filtered messages and the cumulative gas used are
+        // tracked per ExecutionProcessor, each transaction gets its own one.
+        silkworm::ExecutionProcessor ep{block, engine, state, *ctx.chain_config};
+
+        check(tx.max_priority_fee_per_gas == tx.max_fee_per_gas, "max_priority_fee_per_gas must be equal to max_fee_per_gas");
+        check(tx.max_fee_per_gas >= _config->get_gas_price(), "gas price is too low");
 
-    auto receipt = execute_tx(rc, miner, block, txn, ep);
+        // Filter EVM messages (with data) that are sent to the reserved address
+        // corresponding to the EOS account holding the contract (self)
+        ep.set_evm_message_filter([&](const evmc_message& message) -> bool {
+            static auto me = make_reserved_address(get_self().value);
+            return message.recipient == me && message.input_size > 0;
+        });
+
+        auto receipt = execute_tx(rc, miner, block, txn, ep, miner_fee);
 
-    process_filtered_messages(ep.state().filtered_messages());
+        process_filtered_messages(ep.state().filtered_messages());
 
-    engine.finalize(ep.state(), ep.evm().block());
-    ep.state().write_to_db(ep.evm().block().header.number);
-    if (current_version >= 1) {
-        auto event = evmtx_type{evmtx_v0{current_version, txn.get_rlptx()}};
-        action(std::vector<permission_level>{}, get_self(), "evmtx"_n, event)
-            .send();
+        {
+            scoped_stage timer{stage::write_to_db};
+            engine.finalize(ep.state(), ep.evm().block());
+            ep.state().write_to_db(ep.evm().block().header.number);
+            // Next transaction must see the updates of this one
+            state.flush();
+        }
+#ifdef WITH_TX_STATS
+        stats.push_back(tx_stats{receipt.cumulative_gas_used, state.stats});
+#endif
+        if (current_version >= 1) {
+            scoped_stage timer{stage::events};
+            auto event = evmtx_type{evmtx_v0{current_version, txn.get_rlptx()}};
+            action(std::vector<permission_level>{}, get_self(), "evmtx"_n, event)
+                .send();
+        }
     }
-    LOGTIME("EVM END");
-}
 
-void evm_contract::pushtx(eosio::name miner, bytes rlptx) {
-    LOGTIME("EVM START0");
-    assert_unfrozen();
+    if (miner_fee != 0) {
+        balances balance_table(get_self(), get_self().value);
+        balance_table.modify(balance_table.get(miner.value), eosio::same_payer, [&](balance& b){
+            b.balance += miner_fee;
+        });
+    }
+
+    // Reclaim some of the RAM of destroyed accounts, collected rows are erased
+    // so the next call resumes where this one stopped
+    if(auto budget = _config->get_gc_budget()) {
+        state.gc(budget);
+    }
+
+#ifdef WITH_TX_STATS
+    if (_report_tx_stats) {
+        auto stats_bin = eosio::pack(stats);
+        set_action_return_value(stats_bin.data(), stats_bin.size());
+    }
+#endif
+}
 
+runtime_config evm_contract::get_pushtx_runtime_config() const {
     // Use default runtime configuration parameters.
     runtime_config rc;
 
@@ -487,7 +713,33 @@ void evm_contract::pushtx(eosio::name miner, bytes rlptx) {
         rc.allow_non_self_miner = false;
     }
 
-    process_tx(rc, miner, transaction{std::move(rlptx)});
+    return rc;
+}
+
+void evm_contract::pushtx(eosio::name miner, bytes rlptx) {
+    scoped_stage timer{stage::action};
+    assert_unfrozen();
+    _report_tx_stats = true;
+
+    std::vector<transaction> txs;
+    txs.emplace_back(std::move(rlptx));
+    process_txs(get_pushtx_runtime_config(), miner, txs);
+}
+
+void evm_contract::pushtxs(eosio::name miner, std::vector<bytes> rlptxs) {
+    scoped_stage timer{stage::action};
+    assert_unfrozen();
+    eosio::check(!rlptxs.empty(), "no transactions");
+    // Transactions of a batch are only visible to the node through evmtx events
+    eosio::check(_config->get_evm_version_and_maybe_promote() >= 1, "pushtxs requires evm version 1 or later");
+    _report_tx_stats = true;
+
+    std::vector<transaction> txs;
+    txs.reserve(rlptxs.size());
+    for(auto& rlptx : rlptxs) {
+        txs.emplace_back(std::move(rlptx));
+    }
+    process_txs(get_pushtx_runtime_config(), miner, txs);
 }
 
 void evm_contract::open(eosio::name owner) {
@@ -529,13 +781,13 @@ void evm_contract::close(eosio::name owner) {
         nextnonce_table.erase(next_nonce_for_owner);
 }
 
-uint64_t evm_contract::get_and_increment_nonce(const name owner) {
+uint64_t evm_contract::get_and_increment_nonce(const name owner, uint64_t count) {
     nextnonces nextnonce_table(get_self(), get_self().value);
 
     const nextnonce& nonce = nextnonce_table.get(owner.value, "caller account has not been opened");
     uint64_t ret = nonce.next_nonce;
-    nextnonce_table.modify(nonce, eosio::same_payer, [](nextnonce& n){
-        ++n.next_nonce;
+    nextnonce_table.modify(nonce, eosio::same_payer, [&](nextnonce& n){
+        n.next_nonce += count;
     });
     return ret;
 }
@@ -560,41 +812,175 @@ void evm_contract::handle_account_transfer(const eosio::asset& quantity, const s
     });
 }
 
-void evm_contract::handle_evm_transfer(eosio::asset quantity, const std::string& memo) {
-    //move all incoming quantity in to the contract's balance. the evm bridge trx will "pull" from this balance
-    balances balance_table(get_self(), get_self().value);
-    balance_table.modify(balance_table.get(get_self().value), eosio::same_payer, [&](balance& b){
-        b.balance.balance += quantity;
-    });
-
+intx::uint256 evm_contract::get_ingress_value(eosio::asset quantity) const {
     //subtract off the ingress bridge fee from the quantity that will be bridged
     quantity -= _config->get_ingress_bridge_fee();
     eosio::check(quantity.amount > 0, "must bridge more than ingress bridge fee");
 
-    const std::optional<Bytes> address_bytes = from_hex(memo);
-    eosio::check(!!address_bytes, "unable to parse destination address");
-
     intx::uint256 value((uint64_t)quantity.amount);
     value *= minimum_natively_representable;
+    return value;
+}
 
+Transaction evm_contract::make_deposit_tx(uint64_t nonce, const evmc::address& to, const intx::uint256& value) const {
     Transaction txn;
     txn.type = TransactionType::kLegacy;
-    txn.nonce = get_and_increment_nonce(get_self());
+    txn.nonce = nonce;
     txn.max_priority_fee_per_gas = _config->get_gas_price();
     txn.max_fee_per_gas = _config->get_gas_price();
     txn.gas_limit = 21000;
-    txn.to = to_evmc_address(*address_bytes);
+    txn.to = to;
     txn.value = value;
     txn.r = 0u;  // r == 0 is pseudo signature that resolves to reserved address range
     txn.s = get_self().value;
+    return txn;
+}
 
+void evm_contract::process_deposits(std::vector<Transaction> txns) {
     runtime_config rc;
     rc.allow_special_signature = true;
     rc.abort_on_failure = true;
     rc.enforce_chain_id = false;
     rc.allow_non_self_miner = false;
 
-    dispatch_tx(rc, transaction{std::move(txn)});
+    // Version 0 has no evmtx event, deposits stay in inline pushtx actions
+    auto current_version = _config->get_evm_version_and_maybe_promote();
+    if (current_version < 1) {
+        for (auto& txn : txns) {
+            dispatch_tx(rc, transaction{std::move(txn)});
+        }
+        return;
+    }
+
+    // With a base fee part of the gas would be burnt instead of paid back to self
+    const bool has_base_fee = get_block_context(current_version).header.base_fee_per_gas.has_value();
+
+    // Deposits are applied in list order: a run of credited deposits is
+    // settled before the EVM runs the next deposit, and the other way round.
+    // The state is dropped before process_txs so no stale row is kept.
+    std::optional<evm_runtime::state> state;
+    std::vector<Transaction> credited;
+    std::vector<transaction> evm_txs;
+    intx::uint256 total_value;
+    bool ran_evm = false;
+
+    auto settle_credited = [&]() {
+        state.reset();
+        if (credited.empty())
+            return;
+
+        // The gas execute_tx would charge comes back to self as the miner, only the value leaves
+        balances balance_table(get_self(), get_self().value);
+        balance_table.modify(balance_table.get(get_self().value), eosio::same_payer, [&](balance& b){
+            b.balance -= total_value;
+        });
+
+        inevm_singleton inevm(get_self(), get_self().value);
+        inevm.set(inevm.get() += total_value, eosio::same_payer);
+
+        for (auto& txn : credited) {
+            scoped_stage timer{stage::events};
+            auto event = evmtx_type{evmtx_v0{current_version, transaction{std::move(txn)}.get_rlptx()}};
+            action(std::vector<permission_level>{}, get_self(), "evmtx"_n, event)
+                .send();
+        }
+        credited.clear();
+        total_value = 0;
+    };
+
+    auto run_evm_txs = [&]() {
+        if (evm_txs.empty())
+            return;
+        process_txs(rc, get_self(), evm_txs);
+        evm_txs.clear();
+        ran_evm = true;
+    };
+
+    for (auto& txn : txns) {
+        // Egress to a reserved address, calls to precompiles and to contracts need the EVM
+        const evmc::address& to = *txn.to;
+        bool needs_evm = has_base_fee || is_reserved_address(to) ||
+                         std::all_of(to.bytes, to.bytes + 18, [](uint8_t b) { return b == 0; });
+        std::optional<Account> initial;
+        if (!needs_evm) {
+            run_evm_txs();
+            if (!state) state.emplace(get_self(), get_self(), false, false);
+            initial = state->read_account(to);
+            needs_evm = initial && initial->code_hash != kEmptyHash;
+        }
+        if (needs_evm) {
+            settle_credited();
+            evm_txs.emplace_back(std::move(txn));
+            continue;
+        }
+
+        Account current = initial.value_or(Account{});
+        current.balance += txn.value;
+        state->update_account(to, initial, current);
+        // A later deposit to the same address must read this one
+        state->flush();
+
+        total_value += txn.value;
+        credited.push_back(std::move(txn));
+    }
+
+    // process_txs collects garbage itself
+    if (auto budget = _config->get_gc_budget(); budget && state && !ran_evm && evm_txs.empty()) {
+        state->gc(budget);
+    }
+    settle_credited();
+    run_evm_txs();
+}
+
+void evm_contract::handle_evm_transfer(eosio::asset quantity, const std::string& memo) {
+    //move all incoming quantity in to the contract's balance. the evm bridge trx will "pull" from this balance
+    balances balance_table(get_self(), get_self().value);
+    balance_table.modify(balance_table.get(get_self().value), eosio::same_payer, [&](balance& b){
+        b.balance.balance += quantity;
+    });
+
+    const intx::uint256 value = get_ingress_value(quantity);
+
+    const std::optional<Bytes> address_bytes = from_hex(memo);
+    eosio::check(!!address_bytes, "unable to parse destination address");
+
+    std::vector<Transaction> txns;
+    txns.push_back(make_deposit_tx(get_and_increment_nonce(get_self()), to_evmc_address(*address_bytes), value));
+    process_deposits(std::move(txns));
+}
+
+void evm_contract::batchdeposit(eosio::name from, const std::vector<deposit_entry>& deposits) {
+    assert_unfrozen();
+    require_auth(from);
+    eosio::check(!deposits.empty(), "no deposits");
+
+    eosio::asset total(0, token_symbol);
+    for (const auto& d : deposits) {
+        eosio::check(d.quantity.symbol == token_symbol, "unexpected symbol");
+        eosio::check(d.quantity.amount > 0, "quantity must be positive");
+        total += d.quantity;
+    }
+
+    //the funds move from the balance of `from` to the contract's balance, the bridge trxs "pull" from it
+    balances balance_table(get_self(), get_self().value);
+    const balance& from_account = balance_table.get(from.value, "account is not open");
+    check(from_account.balance.balance.amount >= total.amount, "overdrawn balance");
+    balance_table.modify(from_account, eosio::same_payer, [&](balance& a) {
+        a.balance.balance -= total;
+    });
+    balance_table.modify(balance_table.get(get_self().value), eosio::same_payer, [&](balance& b){
+        b.balance.balance += total;
+    });
+
+    uint64_t nonce = get_and_increment_nonce(get_self(), deposits.size());
+
+    std::vector<Transaction> txns;
+    txns.reserve(deposits.size());
+    for (const auto& d : deposits) {
+        eosio::check(d.to.size() == kAddressLength, err_msg_invalid_addr);
+        txns.push_back(make_deposit_tx(nonce++, to_address(d.to), get_ingress_value(d.quantity)));
+    }
+    process_deposits(std::move(txns));
 }
 
 void evm_contract::transfer(eosio::name from, eosio::name to, eosio::asset quantity, std::string memo) {
@@ -638,6 +1024,22 @@ bool evm_contract::gc(uint32_t max) {
     return state.gc(max);
 }
 
+bool evm_contract::gcrange(uint64_t id, uint64_t lower, uint64_t upper, uint32_t max) {
+    assert_unfrozen();
+    require_auth(get_self());
+
+    evm_runtime::state state{get_self(), eosio::same_payer};
+    return state.gc_range(id, lower, upper, max);
+}
+
+bool evm_contract::migstorage(uint32_t max) {
+    assert_unfrozen();
+    require_auth(get_self());
+
+    evm_runtime::state state{get_self(), get_self()};
+    return state.migrate_storage(max);
+}
+
 void evm_contract::call_(const runtime_config& rc, intx::uint256 s, const bytes& to, intx::uint256 value, const bytes& data, uint64_t gas_limit, uint64_t nonce) {
 
     Transaction txn;
@@ -660,9 +1062,11 @@ void evm_contract::call_(const runtime_config& rc, intx::uint256 s, const bytes&
     dispatch_tx(rc, transaction{std::move(txn)});
 }
 
-void evm_contract::dispatch_tx(const runtime_config& rc, const transaction& tx) {
+void evm_contract::dispatch_tx(const runtime_config& rc, transaction tx) {
     if (_config->get_evm_version_and_maybe_promote() >= 1) {
-        process_tx(rc, get_self(), tx);
+        std::vector<transaction> txs;
+        txs.emplace_back(std::move(tx));
+        process_txs(rc, get_self(), txs);
     } else {
         eosio::check(rc.allow_special_signature && rc.abort_on_failure && !rc.enforce_chain_id && !rc.allow_non_self_miner, "invalid runtime config");
         pushtx_action pushtx_act(get_self(), {{get_self(), "active"_n}});
@@ -673,6 +1077,7 @@ void evm_contract::dispatch_tx(const runtime_config& rc, const transaction& tx)
 void evm_contract::call(eosio::name from, const bytes& to, const bytes& value, const bytes& data, uint64_t gas_limit) {
     assert_unfrozen();
     require_auth(from);
+    _report_tx_stats = true;
 
     // Prepare v
     eosio::check(value.size() == sizeof(intx::uint256), "invalid value");
@@ -728,7 +1133,8 @@ void evm_contract::admincall(const bytes& from, const bytes& to, const bytes& va
     call_(rc, s, to, v, data, gas_limit, nonce);
 }
 
-void evm_contract::bridgereg(eosio::name receiver, eosio::name handler, const eosio::asset& min_fee) {
+void evm_contract::bridgereg(eosio::name receiver, eosio::name handler, const eosio::asset& min_fee,
+                             const eosio::binary_extension<uint32_t>& max_queued) {
     assert_unfrozen();
     require_auth(receiver);
     require_auth(get_self());  // to temporarily prevent registration of unauthorized accounts
@@ -741,6 +1147,7 @@ void evm_contract::bridgereg(eosio::name receiver, eosio::name handler, const eo
         row.handler = handler;
         row.min_fee = min_fee;
         row.flags   = message_receiver::FORCE_ATOMIC;
+        row.max_queued = max_queued.value_or(0);
     };
 
     message_receiver_table message_receivers(get_self(), get_self().value);
@@ -762,9 +1169,41 @@ void evm_contract::bridgeunreg(eosio::name receiver) {
     message_receiver_table message_receivers(get_self(), get_self().value);
     auto it = message_receivers.find(receiver.value);
     eosio::check(it != message_receivers.end(), "receiver not found");
+    eosio::check(it->queued.value() == 0, "receiver has queued messages");
     message_receivers.erase(*it);
 }
 
+void evm_contract::release_queued(eosio::name receiver, uint32_t count) {
+    if(count == 0) return;
+    message_receiver_table message_receivers(get_self(), get_self().value);
+    message_receivers.modify(message_receivers.get(receiver.value, "receiver not found"), eosio::same_payer, [&](message_receiver& row) {
+        row.queued = row.queued.value() - count;
+    });
+}
+
+bool evm_contract::processq(eosio::name receiver, uint32_t max) {
+    assert_unfrozen();
+    if(!has_auth(receiver)) require_auth(get_self());
+
+    message_queue_table queue(get_self(), receiver.value);
+    auto it = queue.begin();
+    uint32_t delivered = 0;
+    for(; delivered < max && it != queue.end(); ++delivered) {
+        action(std::vector<permission_level>{}, it->handler, "onbridgemsg"_n, it->message).send();
+        it = queue.erase(it);
+    }
+    release_queued(receiver, delivered);
+    return it == queue.end();
+}
+
+void evm_contract::dropmsg(eosio::name receiver, uint64_t id) {
+    assert_unfrozen();
+    require_auth(receiver);
+
+    message_queue_table queue(get_self(), receiver.value);
+    queue.erase(queue.get(id, "message not found"));
+    release_queued(receiver, 1);
+}
 
 void evm_contract::assertnonce(eosio::name account, uint64_t next_nonce) { 
     nextnonces nextnonce_table(get_self(), get_self().value);
@@ -783,4 +1222,9 @@ void evm_contract::setversion(uint64_t version) {
     _config->set_evm_version(version);
 }
 
+void evm_contract::setgcbudget(uint32_t budget) {
+    require_auth(get_self());
+    _config->set_gc_budget(budget);
+}
+
 } //evm_runtime
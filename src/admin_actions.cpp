@@ -15,25 +15,29 @@ namespace evm_runtime {
     eosio::require_auth(get_self());
     eosio::check(key.size() == 32 && (!value.has_value() || value.value().size() == 32), "invalid key/value size");
 
-    storage_table db(get_self(), account_id);
-    auto inx = db.get_index<"by.key"_n>();
-    auto itr = inx.find(make_key(key));
+    storage2_table db(get_self(), account_id);
+    auto skey = make_key(key);
+    auto itr = storage2_find(db, skey);
+
+    // Slots of accounts not migrated yet may still live in the legacy table
+    storage_table legacy(get_self(), account_id);
+    auto linx = legacy.get_index<"by.key"_n>();
+    auto litr = linx.find(skey);
 
     if(value.has_value()) {
-        if(itr == inx.end()) {
-            db.emplace(get_self(), [&](auto& row){
-                row.id = db.available_primary_key();
-                row.key = key;
-                row.value = value.value();
-            });
+        if(itr == db.end()) {
+            storage2_insert(db, get_self(), skey, make_key(value.value()));
         } else {
-            db.modify(*itr, eosio::same_payer, [&](auto& row){
-                row.value = value.value();
+            db.modify(itr, eosio::same_payer, [&](auto& row){
+                row.value = make_key(value.value());
             });
         }
+        if(litr != linx.end()) linx.erase(litr);
     } else {
-        eosio::check(itr != inx.end(), "key not found");
-        db.erase(*itr);
+        bool found = itr != db.end() && !itr->is_tombstone();
+        eosio::check(found || litr != linx.end(), "key not found");
+        if(found) storage2_erase(db, itr);
+        if(litr != linx.end()) linx.erase(litr);
     }
 }
 
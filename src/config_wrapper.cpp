@@ -117,6 +117,19 @@ void config_wrapper::set_evm_version(uint64_t new_version) {
     set_dirty();
 }
 
+uint32_t config_wrapper::get_gc_budget()const {
+    return _cached_config.gc_budget.value_or(0);
+}
+
+void config_wrapper::set_gc_budget(uint32_t gc_budget) {
+    // binary extensions are serialized in order, evm_version must be present before gc_budget
+    if(!_cached_config.evm_version.has_value()) {
+        _cached_config.evm_version.emplace(evm_version_type{});
+    }
+    _cached_config.gc_budget.emplace(gc_budget);
+    set_dirty();
+}
+
 void config_wrapper::set_fee_parameters(const fee_parameters& fee_params,
                         bool allow_any_to_be_unspecified)
 {
@@ -0,0 +1,20 @@
+// keccak256 for ethash (and through it evmone and silkworm) computed by the
+// sha3 host function. Only built WITH_HOST_CRYPTO, keccak512 stays portable.
+#include <cstring>
+
+#include <ethash/keccak.h>
+#include <evm_runtime/intrinsics.hpp>
+
+extern "C" {
+
+union ethash_hash256 ethash_keccak256(const uint8_t* data, size_t size) noexcept {
+    union ethash_hash256 hash;
+    eosio::internal_use_do_not_use::sha3((const char*)data, size, (char*)hash.bytes, sizeof(hash.bytes), 1);
+    return hash;
+}
+
+union ethash_hash256 ethash_keccak256_32(const uint8_t data[32]) noexcept {
+    return ethash_keccak256(data, 32);
+}
+
+}
@@ -0,0 +1,159 @@
+// Precompiled contracts computed by the CRYPTO_PRIMITIVES host functions.
+// Only built WITH_HOST_CRYPTO, the portable versions in silkworm are renamed
+// to *_portable and stay around as a fallback for inputs the host refuses.
+#include <algorithm>
+#include <cstring>
+
+#include <eosio/crypto.hpp>
+#include <ethash/keccak.hpp>
+#include <evm_runtime/intrinsics.hpp>
+#include <intx/intx.hpp>
+#include <silkworm/core/execution/precompile.hpp>
+
+namespace silkworm::precompile {
+
+std::optional<Bytes> expmod_run_portable(ByteView input) noexcept;
+
+namespace {
+
+// Operands of mod_exp larger than this are left to the portable code
+constexpr uint64_t kMaxHostModExpLen{1024};
+
+// Input truncated or zero padded on the right to `size` bytes
+Bytes right_pad(ByteView input, size_t size) {
+    Bytes out{input.substr(0, std::min(input.size(), size))};
+    out.resize(size, 0);
+    return out;
+}
+
+}  // namespace
+
+std::optional<Bytes> ecrec_run(ByteView input) noexcept {
+    const Bytes d{right_pad(input, 128)};
+
+    // hash || v || r || s, v must be 27 or 28
+    if (std::any_of(&d[32], &d[63], [](uint8_t b) { return b != 0; }) || (d[63] != 27 && d[63] != 28)) {
+        return Bytes{};
+    }
+
+    uint8_t signature[65];
+    signature[0] = d[63];
+    std::memcpy(signature + 1, &d[64], 64);
+
+    // 0x04 || x || y
+    uint8_t public_key[65];
+    if (eosio::internal_use_do_not_use::k1_recover((const char*)signature, sizeof(signature),
+                                                   (const char*)&d[0], 32,
+                                                   (char*)public_key, sizeof(public_key)) != 0) {
+        return Bytes{};
+    }
+
+    const ethash::hash256 key_hash{ethash::keccak256(public_key + 1, sizeof(public_key) - 1)};
+    Bytes out(32, 0);
+    std::memcpy(&out[12], key_hash.bytes + 12, 20);
+    return out;
+}
+
+std::optional<Bytes> sha256_run(ByteView input) noexcept {
+    const auto hash{eosio::sha256((const char*)input.data(), input.size()).extract_as_byte_array()};
+    return Bytes{hash.begin(), hash.end()};
+}
+
+std::optional<Bytes> rip160_run(ByteView input) noexcept {
+    const auto hash{eosio::ripemd160((const char*)input.data(), input.size()).extract_as_byte_array()};
+    Bytes out(32, 0);
+    std::memcpy(&out[32 - hash.size()], hash.data(), hash.size());
+    return out;
+}
+
+std::optional<Bytes> expmod_run(ByteView input) noexcept {
+    const Bytes head{right_pad(input, 3 * 32)};
+    const intx::uint256 base_len256{intx::be::unsafe::load<intx::uint256>(&head[0])};
+    const intx::uint256 exp_len256{intx::be::unsafe::load<intx::uint256>(&head[32])};
+    const intx::uint256 mod_len256{intx::be::unsafe::load<intx::uint256>(&head[64])};
+
+    if (base_len256 > kMaxHostModExpLen || exp_len256 > kMaxHostModExpLen || mod_len256 > kMaxHostModExpLen) {
+        return expmod_run_portable(input);
+    }
+
+    const auto base_len{static_cast<size_t>(base_len256)};
+    const auto exp_len{static_cast<size_t>(exp_len256)};
+    const auto mod_len{static_cast<size_t>(mod_len256)};
+    if (mod_len == 0) {
+        return Bytes{};
+    }
+
+    ByteView rest{input.substr(std::min<size_t>(input.size(), 3 * 32))};
+    const Bytes base{right_pad(rest, base_len)};
+    rest.remove_prefix(std::min(rest.size(), base_len));
+    const Bytes exp{right_pad(rest, exp_len)};
+    rest.remove_prefix(std::min(rest.size(), exp_len));
+    const Bytes mod{right_pad(rest, mod_len)};
+
+    Bytes out(mod_len, 0);
+    if (eosio::internal_use_do_not_use::mod_exp((const char*)base.data(), base.size(),
+                                                (const char*)exp.data(), exp.size(),
+                                                (const char*)mod.data(), mod.size(),
+                                                (char*)out.data(), out.size()) != 0) {
+        return expmod_run_portable(input);
+    }
+    return out;
+}
+
+std::optional<Bytes> bn_add_run(ByteView input) noexcept {
+    const Bytes d{right_pad(input, 128)};
+    Bytes out(64, 0);
+    if (eosio::internal_use_do_not_use::alt_bn128_add((const char*)&d[0], 64, (const char*)&d[64], 64,
+                                                      (char*)out.data(), out.size()) != 0) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+std::optional<Bytes> bn_mul_run(ByteView input) noexcept {
+    const Bytes d{right_pad(input, 96)};
+    Bytes out(64, 0);
+    if (eosio::internal_use_do_not_use::alt_bn128_mul((const char*)&d[0], 64, (const char*)&d[64], 32,
+                                                      (char*)out.data(), out.size()) != 0) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+std::optional<Bytes> snarkv_run(ByteView input) noexcept {
+    if (input.size() % 192 != 0) {
+        return std::nullopt;
+    }
+
+    // 0 if the pairing check holds, 1 if it does not, negative on invalid points
+    const int32_t rc{input.empty() ? 0 : eosio::internal_use_do_not_use::alt_bn128_pair((const char*)input.data(), input.size())};
+    if (rc < 0) {
+        return std::nullopt;
+    }
+
+    Bytes out(32, 0);
+    out[31] = rc == 0 ? 1 : 0;
+    return out;
+}
+
+std::optional<Bytes> blake2_f_run(ByteView input) noexcept {
+    // rounds || h || m || t0 || t1 || f
+    if (input.size() != 213) {
+        return std::nullopt;
+    }
+    const uint8_t f{input[212]};
+    if (f != 0 && f != 1) {
+        return std::nullopt;
+    }
+
+    const uint32_t rounds{(uint32_t{input[0]} << 24) | (uint32_t{input[1]} << 16) | (uint32_t{input[2]} << 8) | uint32_t{input[3]}};
+    Bytes out(64, 0);
+    if (eosio::internal_use_do_not_use::blake2_f(rounds, (const char*)&input[4], 64, (const char*)&input[68], 128,
+                                                 (const char*)&input[196], 8, (const char*)&input[204], 8, f,
+                                                 (char*)out.data(), out.size()) != 0) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+}  // namespace silkworm::precompile
@@ -1,4 +1,5 @@
 #include <map>
+#include <cstring>
 #include <evm_runtime/tables.hpp>
 #include <evm_runtime/state.hpp>
 #include <ethash/keccak.hpp>
@@ -7,26 +8,105 @@
 
 namespace evm_runtime {
 
-std::optional<Account> state::read_account(const evmc::address& address) const noexcept {    
-    account_table accounts(_self, _self.value);
-    auto inx = accounts.get_index<"by.address"_n>();
-    auto itr = inx.find(make_key(address));
+namespace {
+
+// splitmix64 finalizer, a bijection on 64 bit words
+uint64_t mix64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+}  // namespace
+
+uint64_t storage2_key(const checksum256& key) {
+    // Mix each big endian word into the result, so that slots differing in
+    // any bit (including small consecutive slots) get unrelated home keys
+    const auto bytes = key.extract_as_byte_array();
+    uint64_t res = 0;
+    for(size_t i = 0; i < bytes.size(); i += 8) {
+        uint64_t word = 0;
+        for(size_t j = 0; j < 8; ++j) word = (word << 8) | bytes[i+j];
+        res = mix64(res ^ word);
+    }
+    return res;
+}
+
+storage2_table::const_iterator storage2_find(const storage2_table& db, const checksum256& key) {
+    for(uint64_t pk = storage2_key(key);; ++pk) {
+        auto itr = db.find(pk);
+        if(itr == db.end() || itr->key == key) return itr;
+    }
+}
+
+void storage2_insert(storage2_table& db, name payer, const checksum256& key, const checksum256& value) {
+    uint64_t pk = storage2_key(key);
+    auto itr = db.find(pk);
+    while(itr != db.end() && !itr->is_tombstone()) {
+        itr = db.find(++pk);
+    }
+
+    if(itr != db.end()) {
+        db.modify(itr, eosio::same_payer, [&](auto& row){
+            row.key = key;
+            row.value = value;
+        });
+        return;
+    }
+
+    db.emplace(payer, [&](auto& row){
+        row.id = pk;
+        row.key = key;
+        row.value = value;
+    });
+}
+
+void storage2_erase(storage2_table& db, storage2_table::const_iterator itr) {
+    uint64_t pk = itr->id;
+    if(db.find(pk+1) != db.end()) {
+        db.modify(itr, eosio::same_payer, [&](auto& row){
+            row.value = checksum256();
+        });
+        return;
+    }
+
+    // End of a probe run, tombstones right before it are not needed anymore
+    db.erase(itr);
+    for(itr = db.find(--pk); itr != db.end() && itr->is_tombstone(); itr = db.find(--pk)) {
+        db.erase(itr);
+    }
+}
+
+const account* state::find_account(const evmc::address& address) const {
+    auto itr = addr2account.find(address);
+    if(itr != addr2account.end()) return itr->second;
+
+    auto inx = _accounts.get_index<"by.address"_n>();
+    auto itr2 = inx.find(make_key(address));
     ++stats.account.read;
 
-    if (itr == inx.end()) {
+    const account* row = itr2 == inx.end() ? nullptr : &*itr2;
+    addr2account[address] = row;
+    return row;
+}
+
+std::optional<Account> state::read_account(const evmc::address& address) const noexcept {
+    const account* itr = find_account(address);
+    if (!itr) {
         return {};
     }
     eosio::check(_allow_frozen || !itr->has_flag(account::flag::frozen), "account is frozen");
 
-    addr2id[address] = itr->id;
-
     evmc::bytes32 code_hash;
-    if (itr->code_id) {
-        account_code_table codes(_self, _self.value);
-        auto citr = codes.find(itr->code_id.value());
-        if (citr != codes.end()) {
+    if (itr->code_id && itr->code_hash.has_value()) {
+        code_hash = to_bytes32(itr->code_hash.value());
+    } else if (itr->code_id) {
+        // Rows written before the code hash was kept in the account
+        auto citr = _codes.find(itr->code_id.value());
+        ++stats.code.read;
+        if (citr != _codes.end()) {
             code_hash = to_bytes32(citr->code_hash);
-            addr2code[code_hash] = citr->code;
+            addr2code.emplace(code_hash, &*citr);
         } else {
             // Should not reach here! 
             // Return empty hash for robustness.
@@ -40,51 +120,45 @@ std::optional<Account> state::read_account(const evmc::address& address) const n
 }
 
 ByteView state::read_code(const evmc::bytes32& code_hash) const noexcept {
-    
-    if(addr2code.find(code_hash) != addr2code.end()) {
-        const auto& code = addr2code[code_hash];
-        return ByteView{(const uint8_t*)code.data(), code.size()};
-    }
-    
-    account_code_table codes(_self, _self.value);
-    auto inx = codes.get_index<"by.codehash"_n>();
-    auto itr = inx.find(make_key(code_hash));
-    
-    if (itr == inx.end() || itr->code.size() == 0) {
-        return ByteView{};
+    auto itr = addr2code.find(code_hash);
+    if(itr == addr2code.end()) {
+        auto inx = _codes.get_index<"by.codehash"_n>();
+        auto citr = inx.find(make_key(code_hash));
+        ++stats.code.read;
+        if (citr == inx.end()) {
+            return ByteView{};
+        }
+        itr = addr2code.emplace(code_hash, &*citr).first;
+    } else {
+        ++stats.code_cache_hits;
     }
 
-    addr2code[code_hash] = itr->code;
-    const auto& code = addr2code[code_hash];
+    const auto& code = itr->second->code;
     return ByteView{(const uint8_t*)code.data(), code.size()};
 }
 
 evmc::bytes32 state::read_storage(const evmc::address& address, uint64_t incarnation,
                                           const evmc::bytes32& location) const noexcept {
     
-    uint64_t account_id = 0;
-    if(addr2id.find(address) == addr2id.end()) {
-        account_table accounts(_self, _self.value);
-        auto inx = accounts.get_index<"by.address"_n>();
-        auto itr = inx.find(make_key(address));
-        ++stats.account.read;
-        if (itr == inx.end()) return {};
-        addr2id[address] = itr->id;
-    }
+    const account* row = find_account(address);
+    if (!row) return {};
+
+    storage2_table db(_self, row->id);
+    auto itr2 = storage2_find(db, make_key(location));
+    ++stats.storage.read;
 
-    account_id = addr2id[address];
+    if(itr2 != db.end()) return to_bytes32(itr2->value);
+    if(row->has_flag(account::flag::storage_v2)) return {};
 
-    storage_table db(_self, account_id);
-    auto inx2 = db.get_index<"by.key"_n>();
-    auto itr2 = inx2.find(make_key(location));
+    // Account not migrated yet, the slot may still be in the legacy table
+    storage_table legacy(_self, row->id);
+    auto inx = legacy.get_index<"by.key"_n>();
+    auto itr = inx.find(make_key(location));
     ++stats.storage.read;
-    
-    if(itr2 == inx2.end()) return {};
 
-    evmc::bytes32 res;
-    std::copy(itr2->value.begin(), itr2->value.end(), res.bytes);
+    if(itr == inx.end()) return {};
 
-    return res;
+    return to_bytes32(itr->value);
 }
 
 uint64_t state::previous_incarnation(const evmc::address& address) const noexcept {
@@ -98,77 +172,29 @@ void state::update_account(const evmc::address& address, std::optional<Account>
     check(!_read_only, "ro state");
     const bool equal{current == initial};
     if(equal) return;
-    
-    account_table accounts(_self, _self.value);
-    auto inx = accounts.get_index<"by.address"_n>();
-    auto itr = inx.find(make_key(address));
-    ++stats.account.read;
-
-    auto emplace = [&](auto& row) {
-        row.id = get_next_account_id();
-        row.eth_address = to_bytes(address);
-        row.nonce = current->nonce;
-        row.balance = to_bytes(current->balance);
-        // Codes are not supposed to changed in this call.
-        row.code_id = std::nullopt;
-        row.flags = 0;
-    };
-
-    auto update = [&](auto& row) {
-        row.nonce = current->nonce;
-        row.balance = to_bytes(current->balance);
-        // Codes are not supposed to changed in this call.
-    };
 
-    auto remove_account = [&](auto& itr) {
-        storage_table db(_self, itr->id);
-        // add to garbage collection table for later removal
-        gc_store_table gc(_self, _self.value);
-        gc.emplace(_ram_payer, [&](auto& row){
-            row.id = gc.available_primary_key();
-            row.storage_id = itr->id;
-        });
-        // Remove code if necessary
-        if (itr->code_id) {
-            account_code_table codes(_self, _self.value);
-            const auto& itrc = codes.get(itr->code_id.value(), "code not found");
-            if(itrc.ref_count-1) {
-                codes.modify(itrc, eosio::same_payer, [&](auto& row){
-                    row.ref_count--;
-                });
-            } else {
-                codes.erase(itrc);
-            }
-        }
-        accounts.erase(*itr);
-    };
-
-
-    if (current.has_value()) {
-        if (itr == inx.end()) {
-            accounts.emplace(_ram_payer, emplace);
-            ++stats.account.create;
-        } else {
-            if( initial && initial->incarnation != current->incarnation ) {
-                remove_account(itr);
-                accounts.emplace(_ram_payer, emplace);
-            } else {
-                accounts.modify(*itr, eosio::same_payer, update);
-                ++stats.account.update;
-            }
-        }
-    } else {
-        if(itr != inx.end()) {
-            remove_account(itr);
-            ++stats.account.remove;
-        }
+    auto itr = _pending.find(address);
+    if(itr != _pending.end() && (itr->second.account || itr->second.code)) {
+        // Never merge two account updates, write the previous one first
+        flush();
     }
+
+    auto& writes = _pending[address];
+    if(!writes.account && !writes.code) _pending_account_order.push_back(address);
+    writes.account.emplace(std::move(initial), std::move(current));
 }
 
 bool state::gc(uint32_t max) {
     gc_store_table gc(_self, _self.value);
     auto i = gc.begin();
     while( max && i != gc.end() ) {
+        storage2_table db2(_self, i->storage_id);
+        auto sitr2 = db2.begin();
+        while( max && sitr2 != db2.end() ) {
+            sitr2 = db2.erase(sitr2);
+            --max;
+        }
+        if( !max ) break;
         storage_table db(_self, i->storage_id);
         auto sitr = db.begin();
         while( max && sitr != db.end() ) {
@@ -183,99 +209,264 @@ bool state::gc(uint32_t max) {
     return gc.begin() == gc.end();
 }
 
+bool state::gc_range(uint64_t id, uint64_t lower, uint64_t upper, uint32_t max) {
+    check(lower <= upper, "invalid range");
+    gc_store_table gc(_self, _self.value);
+    const auto& row = gc.get(id, "gc row not found");
+
+    storage2_table db2(_self, row.storage_id);
+    auto sitr2 = db2.lower_bound(lower);
+    while( max && sitr2 != db2.end() && sitr2->id <= upper ) {
+        sitr2 = db2.erase(sitr2);
+        --max;
+    }
+    if( sitr2 != db2.end() && sitr2->id <= upper ) return false;
+
+    storage_table db(_self, row.storage_id);
+    auto sitr = db.lower_bound(lower);
+    while( max && sitr != db.end() && sitr->id <= upper ) {
+        sitr = db.erase(sitr);
+        --max;
+    }
+    return sitr == db.end() || sitr->id > upper;
+}
+
+bool state::migrate_storage(uint32_t max) {
+    auto& cfg = get_config2();
+    auto itr = _accounts.lower_bound(cfg.next_migrate_account_id.value_or(0));
+    while( max && itr != _accounts.end() ) {
+        if( !itr->has_flag(account::flag::storage_v2) ) {
+            storage_table db(_self, itr->id);
+            storage2_table db2(_self, itr->id);
+            auto sitr = db.begin();
+            while( max && sitr != db.end() ) {
+                auto key = make_key(sitr->key);
+                // A slot already written to storage2 holds the newer value
+                if( storage2_find(db2, key) == db2.end() ) {
+                    storage2_insert(db2, _ram_payer, key, make_key(sitr->value));
+                }
+                sitr = db.erase(sitr);
+                --max;
+            }
+            if( !max ) break;
+            // Legacy rows may also predate the code hash, fill it in while the row is rewritten
+            std::optional<checksum256> code_hash;
+            if( itr->code_id && !itr->code_hash.has_value() ) {
+                auto citr = _codes.find(itr->code_id.value());
+                ++stats.code.read;
+                if( citr != _codes.end() ) code_hash = make_key(citr->code_hash);
+            }
+            _accounts.modify(*itr, eosio::same_payer, [&](auto& row){
+                row.set_flag(account::flag::storage_v2);
+                if( code_hash ) row.code_hash = *code_hash;
+            });
+        }
+        ++itr;
+        --max;
+    }
+
+    if( itr != _accounts.end() ) {
+        cfg.next_migrate_account_id = itr->id;
+        return false;
+    }
+    cfg.next_migrate_account_id = cfg.next_account_id;
+    return true;
+}
+
 void state::update_account_code(const evmc::address& address, uint64_t, const evmc::bytes32& code_hash, ByteView code) {
     check(!_read_only, "ro state");
-    account_code_table codes(_self, _self.value);
-    auto inxc = codes.get_index<"by.codehash"_n>();
-    auto itrc = inxc.find(make_key(code_hash));
-    uint64_t code_id;
-    if(itrc == inxc.end()) {
-        code_id = codes.available_primary_key();
-        codes.emplace(_ram_payer, [&](auto& row){
-            row.id = code_id;
-            row.code_hash = to_bytes(code_hash);
-            row.code = bytes{code.begin(), code.end()};
-            row.ref_count = 1;
-        });
-    } else {
-        // code should be immutable
-        codes.modify(*itrc, eosio::same_payer, [&](auto& row){
-            row.ref_count++;
-        });
-        code_id = itrc->id;
-    }
-    
-    account_table accounts(_self, _self.value);
-    auto inx = accounts.get_index<"by.address"_n>();
-    auto itr = inx.find(make_key(address));
-    ++stats.account.read;
-    if( itr != inx.end() ) {
-        accounts.modify(*itr, eosio::same_payer, [&](auto& row){
-            row.code_id = code_id;
-        });
-        ++stats.account.update;
-    } else {
-        accounts.emplace(_ram_payer, [&](auto& row){
-            row.id = get_next_account_id();;
-            row.eth_address = to_bytes(address);
-            row.nonce = 0;
-            row.code_id = code_id;
-        });
-        ++stats.account.create;
+
+    auto itr = _pending.find(address);
+    if(itr != _pending.end() && itr->second.code) {
+        flush();
     }
+
+    auto& writes = _pending[address];
+    if(!writes.account && !writes.code) _pending_account_order.push_back(address);
+    writes.code.emplace(code_hash, bytes{code.begin(), code.end()});
 }
 
 void state::update_storage(const evmc::address& address, uint64_t incarnation, const evmc::bytes32& location,
                                    const evmc::bytes32& initial, const evmc::bytes32& current) {
-    
     check(!_read_only, "ro state");
-    account_table accounts(_self, _self.value);
-    auto inx = accounts.get_index<"by.address"_n>();
-    auto itr = inx.find(make_key(address));
-    ++stats.account.read;
 
-    if (is_zero(current)) {
-        if(itr == inx.end()) return;
-        storage_table db(_self, itr->id);
-        auto inx2 = db.get_index<"by.key"_n>();
-        auto itr2 = inx2.find(make_key(location));
-        ++stats.storage.read;
-        if(itr2 == inx2.end()) return;
-        db.erase(*itr2);
-        ++stats.storage.remove;
-    } else {
-        uint64_t table_id;
-        if(itr == inx.end()){
-            accounts.emplace(_ram_payer, [&](auto& row){
-                table_id = get_next_account_id();
-                row.id = table_id;
-                row.eth_address = to_bytes(address);
-                row.nonce = 0;
-                row.code_id = std::nullopt;
-            });
-            ++stats.account.read;
-        } else {
-            table_id = itr->id;
+    auto itr = _pending.find(address);
+    if(itr != _pending.end() && (itr->second.account || itr->second.code)) {
+        // Storage is always written before the account it belongs to
+        flush();
+    }
+
+    auto& writes = _pending[address];
+    if(writes.storage.empty()) _pending_storage_order.push_back(address);
+    writes.storage[location] = current;
+}
+
+void state::flush() {
+    if(_pending.empty()) return;
+
+    // Accounts resolved while executing (addr2account) are not looked up again
+    auto create_account = [&](const evmc::address& address, auto&& init) -> const account* {
+        const account* created = &*_accounts.emplace(_ram_payer, [&](auto& row){
+            row.id = get_next_account_id();
+            row.eth_address = to_bytes(address);
+            row.nonce = 0;
+            row.code_id = std::nullopt;
+            row.flags = static_cast<uint32_t>(account::flag::storage_v2);
+            init(row);
+        });
+        addr2account[address] = created;
+        ++stats.account.create;
+        return created;
+    };
+
+    auto remove_account = [&](const evmc::address& address, const account* acc) {
+        // add to garbage collection table for later removal
+        gc_store_table gc(_self, _self.value);
+        gc.emplace(_ram_payer, [&](auto& row){
+            row.id = gc.available_primary_key();
+            row.storage_id = acc->id;
+        });
+        // Remove code if necessary
+        if (acc->code_id) {
+            const auto& itrc = _codes.get(acc->code_id.value(), "code not found");
+            if(itrc.ref_count-1) {
+                _codes.modify(itrc, eosio::same_payer, [&](auto& row){
+                    row.ref_count--;
+                });
+                ++stats.code.update;
+            } else {
+                addr2code.erase(to_bytes32(itrc.code_hash));
+                _codes.erase(itrc);
+                ++stats.code.remove;
+            }
         }
+        _accounts.erase(*acc);
+        addr2account[address] = nullptr;
+    };
 
-        storage_table db(_self, table_id);
-        auto inx2 = db.get_index<"by.key"_n>();
-        auto itr2 = inx2.find(make_key(location));
-        ++stats.storage.read;
-        if(itr2 == inx2.end()) {
-            db.emplace(_ram_payer, [&](auto& row){
-                row.id = db.available_primary_key();
-                row.key = to_bytes(location);
-                row.value = to_bytes(current);
-            });
-            ++stats.storage.create;
-        } else {
-            db.modify(*itr2, eosio::same_payer, [&](auto& row){
-                row.value = to_bytes(current);
-            });
-            ++stats.storage.update;
+    for(const auto& address : _pending_storage_order) {
+        const account* row = find_account(address);
+        std::optional<storage2_table> db;
+        std::optional<storage_table> legacy;
+
+        for(const auto& slot : _pending[address].storage) {
+            const evmc::bytes32& location = slot.first;
+            const evmc::bytes32& current = slot.second;
+            if (is_zero(current)) {
+                if(!row) continue;
+            } else if(!row) {
+                row = create_account(address, [](auto&){});
+            }
+
+            auto key = make_key(location);
+            if(!row->has_flag(account::flag::storage_v2)) {
+                // Drop the legacy copy of the slot, storage2 is authoritative from now on
+                if(!legacy) legacy.emplace(_self, row->id);
+                auto inx = legacy->get_index<"by.key"_n>();
+                auto itr = inx.find(key);
+                if(itr != inx.end()) inx.erase(itr);
+            }
+
+            if(!db) db.emplace(_self, row->id);
+            auto itr2 = storage2_find(*db, key);
+            ++stats.storage.read;
+
+            if (is_zero(current)) {
+                if(itr2 == db->end() || itr2->is_tombstone()) continue;
+                storage2_erase(*db, itr2);
+                ++stats.storage.remove;
+            } else if(itr2 == db->end()) {
+                storage2_insert(*db, _ram_payer, key, make_key(current));
+                ++stats.storage.create;
+            } else {
+                db->modify(itr2, eosio::same_payer, [&](auto& row){
+                    row.value = make_key(current);
+                });
+                ++stats.storage.update;
+            }
+        }
+    }
+
+    for(const auto& address : _pending_account_order) {
+        auto& writes = _pending[address];
+
+        if(writes.account) {
+            const auto& initial = writes.account->first;
+            const auto& current = writes.account->second;
+            const account* row = find_account(address);
+
+            auto init = [&](auto& row) {
+                row.balance = to_bytes(current->balance);
+                row.nonce = current->nonce;
+            };
+
+            if (current.has_value()) {
+                if (!row) {
+                    create_account(address, init);
+                } else if( initial && initial->incarnation != current->incarnation ) {
+                    remove_account(address, row);
+                    create_account(address, init);
+                } else {
+                    _accounts.modify(*row, eosio::same_payer, [&](auto& row){
+                        row.nonce = current->nonce;
+                        row.balance = to_bytes(current->balance);
+                        // Codes are not supposed to changed in this call.
+                        // Rows written before the code hash was kept get it from the read of the account.
+                        if(row.code_id && !row.code_hash.has_value()) row.code_hash = make_key(current->code_hash);
+                    });
+                    ++stats.account.update;
+                }
+            } else if(row) {
+                remove_account(address, row);
+                ++stats.account.remove;
+            }
+        }
+
+        if(writes.code) {
+            const evmc::bytes32& code_hash = writes.code->first;
+            bytes& code = writes.code->second;
+
+            auto inxc = _codes.get_index<"by.codehash"_n>();
+            auto itrc = inxc.find(make_key(code_hash));
+            ++stats.code.read;
+            uint64_t code_id;
+            if(itrc == inxc.end()) {
+                code_id = _codes.available_primary_key();
+                _codes.emplace(_ram_payer, [&](auto& row){
+                    row.id = code_id;
+                    row.code_hash = to_bytes(code_hash);
+                    row.code = std::move(code);
+                    row.ref_count = 1;
+                });
+                ++stats.code.create;
+            } else {
+                // code should be immutable
+                _codes.modify(*itrc, eosio::same_payer, [&](auto& row){
+                    row.ref_count++;
+                });
+                ++stats.code.update;
+                code_id = itrc->id;
+            }
+
+            const account* row = find_account(address);
+            if( row ) {
+                _accounts.modify(*row, eosio::same_payer, [&](auto& row){
+                    row.code_id = code_id;
+                    row.code_hash = make_key(code_hash);
+                });
+                ++stats.account.update;
+            } else {
+                create_account(address, [&](auto& row){
+                    row.code_id = code_id;
+                    row.code_hash = make_key(code_hash);
+                });
+            }
         }
     }
+
+    _pending.clear();
+    _pending_storage_order.clear();
+    _pending_account_order.clear();
 }
 
 std::optional<BlockHeader> state::read_header(uint64_t block_number,
@@ -331,7 +522,7 @@ evmc::bytes32 state::state_root_hash() const {
     return {};
 }
 
-uint64_t state::get_next_account_id() {
+config2& state::get_config2() {
     if(!_config2) {
         eosio::singleton<"config2"_n, config2> cfg2{_self, _self.value};
         if(cfg2.exists()) {
@@ -341,15 +532,67 @@ uint64_t state::get_next_account_id() {
             _config2 = config2{accounts.available_primary_key()};
         }
     }
-    auto id = _config2->next_account_id;
-    _config2->next_account_id++;
+    return *_config2;
+}
+
+uint64_t state::get_next_account_id() {
+    auto& cfg = get_config2();
+    auto id = cfg.next_account_id;
+    cfg.next_account_id++;
     return id;
 }
 
 state::~state() {
+    flush();
     if(!_config2.has_value()) return;
     eosio::singleton<"config2"_n, config2> cfg2{_self, _self.value};
     cfg2.set(_config2.value(), _self);
 }
 
+overlay_state::overlay_state(const State& base, const std::vector<state_override>& overrides) : _base(base) {
+    for(const auto& o : overrides) {
+        const evmc::address address = to_address(o.address);
+        auto& a = _accounts[address];
+        if(o.balance.has_value()) a.balance = to_uint256(o.balance.value());
+        if(o.nonce.has_value()) a.nonce = o.nonce.value();
+        if(o.code.has_value()) {
+            Bytes code{(const uint8_t*)o.code->data(), o.code->size()};
+            const auto hash = ethash::keccak256(code.data(), code.size());
+            evmc::bytes32 code_hash;
+            std::memcpy(code_hash.bytes, hash.bytes, sizeof(code_hash.bytes));
+            a.code_hash = code_hash;
+            _codes[code_hash] = std::move(code);
+        }
+        for(const auto& slot : o.storage) {
+            _storage[{address, to_bytes32(slot.key)}] = to_bytes32(slot.value);
+        }
+    }
+}
+
+std::optional<Account> overlay_state::read_account(const evmc::address& address) const noexcept {
+    auto res = _base.read_account(address);
+    auto itr = _accounts.find(address);
+    if(itr == _accounts.end()) return res;
+
+    // An overridden account exists even if it is not on chain
+    if(!res.has_value()) res = Account{};
+    if(itr->second.balance.has_value()) res->balance = *itr->second.balance;
+    if(itr->second.nonce.has_value()) res->nonce = *itr->second.nonce;
+    if(itr->second.code_hash.has_value()) res->code_hash = *itr->second.code_hash;
+    return res;
+}
+
+ByteView overlay_state::read_code(const evmc::bytes32& code_hash) const noexcept {
+    auto itr = _codes.find(code_hash);
+    if(itr != _codes.end()) return itr->second;
+    return _base.read_code(code_hash);
+}
+
+evmc::bytes32 overlay_state::read_storage(const evmc::address& address, uint64_t incarnation,
+                                          const evmc::bytes32& location) const noexcept {
+    auto itr = _storage.find({address, location});
+    if(itr != _storage.end()) return itr->second;
+    return _base.read_storage(address, incarnation, location);
+}
+
 }  // namespace evm_runtime
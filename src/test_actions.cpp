@@ -32,7 +32,8 @@ using namespace silkworm;
             .enforce_chain_id = false,
             .allow_non_self_miner = true
         };
-        execute_tx(rc, eosio::name{}, block, transaction{std::move(tx)}, ep);
+        intx::uint256 miner_fee; // no miner, stays zero
+        execute_tx(rc, eosio::name{}, block, transaction{std::move(tx)}, ep, miner_fee);
     }
     engine.finalize(ep.state(), ep.evm().block());
     ep.state().write_to_db(ep.evm().block().header.number);
@@ -57,13 +58,15 @@ using namespace silkworm;
     eosio::printhex(addy.data(), addy.size());
 
     uint64_t cnt=0;
-    storage_table db(_self, itr->id);
+    storage2_table db(_self, itr->id);
     auto sitr = db.begin();
     while(sitr != db.end()) {
+        auto key = sitr->key.extract_as_byte_array();
+        auto value = sitr->value.extract_as_byte_array();
         eosio::print("\n");
-        eosio::printhex(sitr->key.data(), sitr->key.size());
+        eosio::printhex(key.data(), key.size());
         eosio::print(":");
-        eosio::printhex(sitr->value.data(), sitr->value.size());
+        eosio::printhex(value.data(), value.size());
         eosio::print("\n");
         ++sitr;
         ++cnt;
@@ -78,10 +81,12 @@ using namespace silkworm;
     eosio::require_auth(get_self());
 
     auto print_store = [](auto sitr) {
+        auto key = sitr->key.extract_as_byte_array();
+        auto value = sitr->value.extract_as_byte_array();
         eosio::print("    ");
-        eosio::printhex(sitr->key.data(), sitr->key.size());
+        eosio::printhex(key.data(), key.size());
         eosio::print(":");
-        eosio::printhex(sitr->value.data(), sitr->value.size());
+        eosio::printhex(value.data(), value.size());
         eosio::print("\n");
     };
 
@@ -92,7 +97,7 @@ using namespace silkworm;
         eosio::print("  account:");
         eosio::printhex(itr->eth_address.data(), itr->eth_address.size());
         eosio::print("\n");
-        storage_table db(_self, itr->id);
+        storage2_table db(_self, itr->id);
         auto sitr = db.begin();
         while( sitr != db.end() ) {
             print_store( sitr );
@@ -108,7 +113,7 @@ using namespace silkworm;
         eosio::print("   storage_id:");
         eosio::print(i->storage_id);
         eosio::print("\n");
-        storage_table db(_self, i->storage_id);
+        storage2_table db(_self, i->storage_id);
         auto sitr = db.begin();
         while( sitr != db.end() ) {
             print_store( sitr );
@@ -133,13 +138,15 @@ using namespace silkworm;
         eosio::print("  account:");
         eosio::printhex(itr->eth_address.data(), itr->eth_address.size());
         eosio::print("\n");
-        storage_table db(_self, itr->id);
+        storage2_table db(_self, itr->id);
         auto sitr = db.begin();
         while( sitr != db.end() ) {
+            auto key = sitr->key.extract_as_byte_array();
+            auto value = sitr->value.extract_as_byte_array();
             eosio::print("    ");
-            eosio::printhex(sitr->key.data(), sitr->key.size());
+            eosio::printhex(key.data(), key.size());
             eosio::print(":");
-            eosio::printhex(sitr->value.data(), sitr->value.size());
+            eosio::printhex(value.data(), value.size());
             eosio::print("\n");
             sitr = db.erase(sitr);
         }
@@ -229,6 +236,7 @@ using namespace silkworm;
             row.code_id = std::nullopt;
             row.eth_address = addy;
             row.balance = bal;
+            row.flags = static_cast<uint32_t>(account::flag::storage_v2);
         });
     } else {
         accounts.modify(*itr, eosio::same_payer, [&](auto& row){
@@ -378,4 +386,32 @@ using namespace silkworm;
     }
 }
 
+
+// Puts an account back in the layout written before storage2: its slots in
+// the legacy storage table (dense primary keys), no storage_v2 flag and no code hash
+[[eosio::action]] void evm_contract::mklegacy(uint64_t id) {
+    assert_unfrozen();
+
+    eosio::require_auth(get_self());
+
+    account_table accounts(get_self(), get_self().value);
+    const auto& row = accounts.get(id, "account not found");
+
+    storage2_table db2(get_self(), id);
+    storage_table db(get_self(), id);
+    for(auto itr = db2.begin(); itr != db2.end(); itr = db2.erase(itr)) {
+        if(itr->is_tombstone()) continue;
+        db.emplace(get_self(), [&](auto& r){
+            r.id = db.available_primary_key();
+            r.key = to_bytes(to_bytes32(itr->key));
+            r.value = to_bytes(to_bytes32(itr->value));
+        });
+    }
+
+    accounts.modify(row, eosio::same_payer, [&](auto& r){
+        r.clear_flag(account::flag::storage_v2);
+        r.code_hash.reset();
+    });
+}
+
 }
\ No newline at end of file
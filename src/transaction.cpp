@@ -0,0 +1,55 @@
+#include <cstring>
+
+#include <evm_runtime/transaction.hpp>
+#include <evm_runtime/intrinsics.hpp>
+
+#include <ethash/keccak.hpp>
+
+namespace evm_runtime {
+
+#ifdef WITH_HOST_CRYPTO
+namespace {
+
+std::optional<evmc::address> recover_address(const silkworm::Transaction& tx) {
+    Bytes rlp;
+    silkworm::rlp::encode(rlp, tx, /*for_signing=*/true, /*wrap_eip2718_into_string=*/false);
+    const ethash::hash256 digest{ethash::keccak256(rlp.data(), rlp.size())};
+
+    // v (27 + recovery id) || r || s
+    uint8_t signature[65];
+    signature[0] = 27 + tx.odd_y_parity;
+    intx::be::unsafe::store(signature + 1, tx.r);
+    intx::be::unsafe::store(signature + 33, tx.s);
+
+    // 0x04 || x || y
+    uint8_t public_key[65];
+    if (eosio::internal_use_do_not_use::k1_recover((const char*)signature, sizeof(signature),
+                                                   (const char*)digest.bytes, sizeof(digest.bytes),
+                                                   (char*)public_key, sizeof(public_key)) != 0) {
+        return {};
+    }
+
+    const ethash::hash256 key_hash{ethash::keccak256(public_key + 1, sizeof(public_key) - 1)};
+    evmc::address address;
+    std::memcpy(address.bytes, key_hash.bytes + 12, sizeof(address.bytes));
+    return address;
+}
+
+}  // namespace
+#endif
+
+void transaction::recover_sender()const {
+    eosio::check(tx_.has_value(), "no tx");
+    auto& tx = tx_.value();
+    tx.from.reset();
+#ifdef WITH_HOST_CRYPTO
+    // Bridge transactions resolve to reserved addresses without any crypto
+    if (!silkworm::is_special_signature(tx.r, tx.s)) {
+        tx.from = recover_address(tx);
+        return;
+    }
+#endif
+    tx.recover_sender();
+}
+
+} //namespace evm_runtime
@@ -53,6 +53,13 @@ evmc::bytes32 to_bytes32(const bytes& data) {
     return res;
 }
 
+evmc::bytes32 to_bytes32(const checksum256& data) {
+    evmc::bytes32 res;
+    auto arr = data.extract_as_byte_array();
+    memcpy(res.bytes, arr.data(), arr.size());
+    return res;
+}
+
 uint256 to_uint256(const bytes& value) {
     uint8_t tmp[32]{0};
     eosio::check(value.size() <= 32, "wrong length");
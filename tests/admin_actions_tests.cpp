@@ -137,6 +137,93 @@ BOOST_FIXTURE_TEST_CASE(rmgcstore_tests, admin_action_tester) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE(gc_budget_tests, admin_action_tester) try {
+
+   evm_eoa evm1, evm2;
+   const int64_t to_bridge = 1000000;
+   transfer_token("alice"_n, evm_account_name, make_asset(to_bridge), evm1.address_0x());
+
+   auto [contract_addr, contract_account_id] = deploy_simple_contract(evm1);
+
+   // Call method "killme" on simple contract (sha3('killme()') = 0x24d97a4a)
+   auto txn = generate_tx(contract_addr, 0, 500'000);
+   txn.data = evmc::from_hex("0x24d97a4a").value();
+   evm1.sign(txn);
+   pushtx(txn);
+   BOOST_REQUIRE(total_gcrows() == 1);
+
+   BOOST_REQUIRE_EXCEPTION(setgcbudget(10, "alice"_n),
+      missing_auth_exception, eosio::testing::fc_exception_message_starts_with("missing authority"));
+
+   // Not enough budget to erase the owner slot and the gcstore row
+   setgcbudget(1);
+   BOOST_REQUIRE(get_config().gc_budget == 1);
+   txn = generate_tx(evm2.address, 1_ether);
+   evm1.sign(txn);
+   pushtx(txn);
+   BOOST_REQUIRE(total_gcrows() == 1);
+
+   setgcbudget(10);
+   txn = generate_tx(evm2.address, 1_ether);
+   evm1.sign(txn);
+   pushtx(txn);
+   BOOST_REQUIRE(total_gcrows() == 0);
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(gcrange_tests, admin_action_tester) try {
+
+   evm_eoa evm1;
+   const int64_t to_bridge = 1000000;
+   transfer_token("alice"_n, evm_account_name, make_asset(to_bridge), evm1.address_0x());
+
+   auto [contract_addr, contract_account_id] = deploy_simple_contract(evm1);
+
+   // setval(0x42) stores slot 0, the constructor stored the owner in slot 1
+   auto txn = generate_tx(contract_addr, 0, 500'000);
+   txn.data = evmc::from_hex("0x559c9c4a").value();
+   txn.data += evmc::from_hex("0x0000000000000000000000000000000000000000000000000000000000000042").value();
+   evm1.sign(txn);
+   pushtx(txn);
+
+   txn = generate_tx(contract_addr, 0, 500'000);
+   txn.data = evmc::from_hex("0x24d97a4a").value();
+   evm1.sign(txn);
+   pushtx(txn);
+   BOOST_REQUIRE(total_gcrows() == 1);
+
+   auto storage_rows = [&]() {
+      std::vector<uint64_t> ids;
+      scan_account_storage(contract_account_id, [&](storage_slot&& slot) -> bool {
+         ids.push_back(slot.id);
+         return false;
+      });
+      return ids;
+   };
+   // slot 0 has home key 0, slot 1 is somewhere above
+   const uint64_t slot1_key = storage2_home_key(1);
+   BOOST_REQUIRE(storage_rows() == std::vector<uint64_t>({0, slot1_key}));
+
+   BOOST_REQUIRE_EXCEPTION(gcrange(0, 1, std::numeric_limits<uint64_t>::max(), 10, "alice"_n),
+      missing_auth_exception, eosio::testing::fc_exception_message_starts_with("missing authority"));
+   BOOST_REQUIRE_EXCEPTION(gcrange(1, 0, 10, 10),
+      eosio_assert_message_exception, eosio_assert_message_is("gc row not found"));
+
+   BOOST_REQUIRE(gcrange(0, 1, slot1_key - 1, 10) == true);
+   BOOST_REQUIRE(storage_rows() == std::vector<uint64_t>({0, slot1_key}));
+
+   BOOST_REQUIRE(gcrange(0, 1, std::numeric_limits<uint64_t>::max(), 10) == true);
+   BOOST_REQUIRE(storage_rows() == std::vector<uint64_t>({0}));
+
+   BOOST_REQUIRE(gcrange(0, 0, 0, 10) == true);
+   BOOST_REQUIRE(storage_rows().empty());
+   BOOST_REQUIRE(total_gcrows() == 1);
+
+   gc(10);
+   BOOST_REQUIRE(total_gcrows() == 0);
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE(setkvstore_tests, admin_action_tester) try {
 
    // Fund evm1 address with 100 EOS
@@ -201,6 +288,152 @@ BOOST_FIXTURE_TEST_CASE(setkvstore_tests, admin_action_tester) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE(migstorage_tests, admin_action_tester) try {
+
+   evm_eoa evm1;
+   const int64_t to_bridge = 1000000;
+   transfer_token("alice"_n, evm_account_name, make_asset(to_bridge), evm1.address_0x());
+
+   auto [contract_addr, contract_account_id] = deploy_simple_contract(evm1);
+
+   auto txn = generate_tx(contract_addr, 0, 500'000);
+   txn.data = evmc::from_hex("0x559c9c4a").value();
+   txn.data += evmc::from_hex("0x0000000000000000000000000000000000000000000000000000000000000042").value();
+   evm1.sign(txn);
+   pushtx(txn);
+
+   // Accounts created by the contract keep their storage in storage2 from the start
+   BOOST_REQUIRE(find_account_by_address(evm1.address)->has_flag(evm_test::account_object::flag::storage_v2));
+   BOOST_REQUIRE(find_account_by_id(contract_account_id)->has_flag(evm_test::account_object::flag::storage_v2));
+
+   BOOST_REQUIRE_EXCEPTION(push_action(evm_account_name, "migstorage"_n, "alice"_n, mvo()("max", 10)),
+      missing_auth_exception, eosio::testing::fc_exception_message_starts_with("missing authority"));
+
+   BOOST_REQUIRE(migstorage(1) == false);
+   produce_blocks(1);
+   BOOST_REQUIRE(migstorage(10) == true);
+   produce_blocks(1);
+   BOOST_REQUIRE(migstorage(10) == true);
+
+   BOOST_REQUIRE(getval(contract_addr) == intx::uint256(66));
+
+} FC_LOG_AND_RETHROW()
+
+// mklegacy is a test action, see the test_build_tests ctest
+BOOST_TEST_DECORATOR(* boost::unit_test::label("test_build"))
+BOOST_FIXTURE_TEST_CASE(migstorage_legacy_tests, admin_action_tester) try {
+
+   evm_eoa evm1;
+   const int64_t to_bridge = 1000000;
+   transfer_token("alice"_n, evm_account_name, make_asset(to_bridge), evm1.address_0x());
+
+   auto [c1_addr, c1_id] = deploy_simple_contract(evm1);
+   auto [c2_addr, c2_id] = deploy_simple_contract(evm1);
+
+   auto setval = [&](const evmc::address& contract, uint8_t v) {
+      auto txn = generate_tx(contract, 0, 500'000);
+      txn.data = evmc::from_hex("0x559c9c4a").value();   // sha3(setval(uint256))[:4]
+      txn.data += evmc::bytes32{v};
+      evm1.sign(txn);
+      pushtx(txn);
+   };
+
+   auto owner_of = [&](const evmc::address& contract) {
+      exec_input input;
+      input.to = bytes{std::begin(contract.bytes), std::end(contract.bytes)};
+      auto data = evmc::from_hex("8da5cb5b").value();    // sha3(owner())[:4]
+      input.data = bytes{data.begin(), data.end()};
+      auto out = fc::raw::unpack<exec_output>(exec(input, {})->action_traces[0].return_value);
+      BOOST_REQUIRE(out.status == 0 && out.data.size() == 32);
+      evmc::address owner;
+      std::memcpy(owner.bytes, out.data.data() + 12, sizeof(owner.bytes));
+      return owner;
+   };
+
+   setval(c1_addr, 0x11);
+   setval(c2_addr, 0x22);
+
+   const auto code_hash = find_account_by_id(c1_id)->code_hash;
+   BOOST_REQUIRE(code_hash.has_value());
+
+   // Both contracts go back to the legacy storage table (slot 0 val, slot 1 owner)
+   mklegacy(c1_id);
+   mklegacy(c2_id);
+   for (auto id : {c1_id, c2_id}) {
+      BOOST_REQUIRE(!find_account_by_id(id)->has_flag(evm_test::account_object::flag::storage_v2));
+      BOOST_REQUIRE(!find_account_by_id(id)->code_hash.has_value());
+      BOOST_REQUIRE(legacy_storage_rows(id) == 2);
+   }
+
+   // Reads fall back to the legacy table
+   BOOST_REQUIRE(getval(c1_addr) == intx::uint256(0x11));
+   BOOST_REQUIRE(getval(c2_addr) == intx::uint256(0x22));
+   BOOST_REQUIRE(owner_of(c1_addr) == evm1.address);
+
+   // evm1 is already migrated, c1 is only partially migrated
+   BOOST_REQUIRE(migstorage(2) == false);
+   BOOST_REQUIRE(legacy_storage_rows(c1_id) == 1);
+   BOOST_REQUIRE(!find_account_by_id(c1_id)->has_flag(evm_test::account_object::flag::storage_v2));
+   BOOST_REQUIRE(getval(c1_addr) == intx::uint256(0x11));
+   BOOST_REQUIRE(owner_of(c1_addr) == evm1.address);
+   produce_blocks(1);
+
+   // A write during the migration drops the legacy copy of the slot
+   setval(c2_addr, 0x33);
+   BOOST_REQUIRE(legacy_storage_rows(c2_id) == 1);
+   BOOST_REQUIRE(getval(c2_addr) == intx::uint256(0x33));
+
+   // The migration resumes where it stopped
+   size_t calls = 0;
+   while (!migstorage(1)) {
+      produce_blocks(1);
+      ++calls;
+   }
+   BOOST_REQUIRE(calls > 1);
+
+   for (auto id : {c1_id, c2_id}) {
+      BOOST_REQUIRE(find_account_by_id(id)->has_flag(evm_test::account_object::flag::storage_v2));
+      BOOST_REQUIRE(find_account_by_id(id)->code_hash == code_hash);
+      BOOST_REQUIRE(legacy_storage_rows(id) == 0);
+   }
+   BOOST_REQUIRE(getval(c1_addr) == intx::uint256(0x11));
+   BOOST_REQUIRE(getval(c2_addr) == intx::uint256(0x33));
+   BOOST_REQUIRE(owner_of(c1_addr) == evm1.address);
+   BOOST_REQUIRE(owner_of(c2_addr) == evm1.address);
+
+   // Writes after the migration only touch storage2
+   setval(c1_addr, 0x44);
+   BOOST_REQUIRE(getval(c1_addr) == intx::uint256(0x44));
+   BOOST_REQUIRE(legacy_storage_rows(c1_id) == 0);
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_TEST_DECORATOR(* boost::unit_test::label("test_build"))
+BOOST_FIXTURE_TEST_CASE(code_hash_backfill_tests, admin_action_tester) try {
+
+   evm_eoa evm1;
+   const int64_t to_bridge = 1000000;
+   transfer_token("alice"_n, evm_account_name, make_asset(to_bridge), evm1.address_0x());
+
+   // Runtime code is a single STOP, so the contract accepts plain transfers
+   auto contract_addr = deploy_contract(evm1, evmc::from_hex("600060005360016000f3").value());
+   const auto contract = find_account_by_address(contract_addr).value();
+   BOOST_REQUIRE(contract.code_id.has_value() && contract.code_hash.has_value());
+
+   mklegacy(contract.id);
+   BOOST_REQUIRE(!find_account_by_id(contract.id)->code_hash.has_value());
+
+   // Updating the balance rewrites the row with the hash read from the code table
+   auto txn = generate_tx(contract_addr, 1, 21'000);
+   evm1.sign(txn);
+   pushtx(txn);
+
+   auto row = find_account_by_id(contract.id).value();
+   BOOST_REQUIRE(row.balance == 1);
+   BOOST_REQUIRE(row.code_hash == contract.code_hash);
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE(rmaccount_tests, admin_action_tester) try {
 
    // Fund evm1 address with 100 EOS
@@ -46,6 +46,7 @@ struct partial_account_table_row
    bytes balance;
    std::optional<uint64_t> code_id;
    uint32_t flags;
+   std::optional<fc::sha256> code_hash;
 };
 
 struct storage_table_row
@@ -55,6 +56,13 @@ struct storage_table_row
    bytes value;
 };
 
+struct storage2_table_row
+{
+   uint64_t id;
+   fc::sha256 key;
+   fc::sha256 value;
+};
+
 } // namespace evm_test
 
 namespace fc { namespace raw {
@@ -68,6 +76,12 @@ namespace fc { namespace raw {
       fc::raw::unpack(ds, tmp.code_id);
       tmp.flags=0;
       if(ds.remaining()) { fc::raw::unpack(ds, tmp.flags); }
+      tmp.code_hash = {};
+      if(ds.remaining()) {
+         fc::sha256 code_hash;
+         fc::raw::unpack(ds, code_hash);
+         tmp.code_hash.emplace(code_hash);
+      }
     } FC_RETHROW_EXCEPTIONS(warn, "error unpacking partial_account_table_row") }
 
     template<>
@@ -87,13 +101,21 @@ namespace fc { namespace raw {
          fc::raw::unpack(ds, version);
          tmp.evm_version.emplace(version);
       }
+
+      tmp.gc_budget = {};
+      if(ds.remaining()) {
+         uint32_t gc_budget;
+         fc::raw::unpack(ds, gc_budget);
+         tmp.gc_budget.emplace(gc_budget);
+      }
     } FC_RETHROW_EXCEPTIONS(warn, "error unpacking partial_account_table_row") }
 }}
 
 
 FC_REFLECT(evm_test::vault_balance_row, (owner)(balance)(dust))
-FC_REFLECT(evm_test::partial_account_table_row, (id)(eth_address)(nonce)(balance)(code_id)(flags))
+FC_REFLECT(evm_test::partial_account_table_row, (id)(eth_address)(nonce)(balance)(code_id)(flags)(code_hash))
 FC_REFLECT(evm_test::storage_table_row, (id)(key)(value))
+FC_REFLECT(evm_test::storage2_table_row, (id)(key)(value))
 
 namespace evm_test {
 
@@ -179,6 +201,52 @@ evmc::address basic_evm_tester::make_reserved_address(name account) {
    return make_reserved_address(account.to_uint64_t());
 }
 
+namespace {
+
+uint64_t mix64(uint64_t x)
+{
+   x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+   x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+   return x ^ (x >> 31);
+}
+
+// Inverse of x ^ (x >> shift)
+uint64_t unxorshift(uint64_t y, unsigned shift)
+{
+   uint64_t x = y;
+   for (unsigned i = shift; i < 64; i += shift) {
+      x = y ^ (x >> shift);
+   }
+   return x;
+}
+
+// Inverse of mix64, the multipliers are the inverses of its constants modulo 2^64
+uint64_t unmix64(uint64_t x)
+{
+   x = unxorshift(x, 31) * 0x319642b2d24d8ec3ull;
+   x = unxorshift(x, 27) * 0x96de1b173f119089ull;
+   return unxorshift(x, 30);
+}
+
+} // namespace
+
+uint64_t basic_evm_tester::storage2_home_key(const intx::uint256& slot)
+{
+   // big endian words, most significant first
+   uint64_t res = 0;
+   for (unsigned shift = 256; shift > 0;) {
+      shift -= 64;
+      res = mix64(res ^ static_cast<uint64_t>(slot >> shift));
+   }
+   return res;
+}
+
+intx::uint256 basic_evm_tester::storage2_slot_with_home_key(uint64_t home, uint64_t tag)
+{
+   // words 0, 0, tag, x: the home key is mix64(mix64(tag) ^ x)
+   return (intx::uint256(tag) << 64) | intx::uint256(unmix64(home) ^ mix64(tag));
+}
+
 basic_evm_tester::basic_evm_tester(std::string native_symbol_str) :
    native_symbol(symbol::from_string(native_symbol_str))
 {
@@ -341,11 +409,35 @@ basic_evm_tester::generate_tx(const evmc::address& to, const intx::uint256& valu
       .value = value,
    };
 }
-transaction_trace_ptr basic_evm_tester::exec(const exec_input& input, const std::optional<exec_callback>& callback) {
+transaction_trace_ptr basic_evm_tester::exec(const exec_input& input, const std::optional<exec_callback>& callback,
+                                             const std::optional<std::vector<state_override>>& overrides) {
    auto binary_data = fc::raw::pack<exec_input, std::optional<exec_callback>>(input, callback);
+   if (overrides.has_value()) {
+      auto overrides_data = fc::raw::pack(*overrides);
+      binary_data.insert(binary_data.end(), overrides_data.begin(), overrides_data.end());
+   }
    return basic_evm_tester::push_action(evm_account_name, "exec"_n, evm_account_name, bytes{binary_data.begin(), binary_data.end()});
 }
 
+transaction_trace_ptr basic_evm_tester::execbatch(const std::vector<exec_input>& inputs,
+                                                  const std::optional<std::vector<state_override>>& overrides) {
+   auto binary_data = fc::raw::pack(inputs);
+   if (overrides.has_value()) {
+      auto overrides_data = fc::raw::pack(*overrides);
+      binary_data.insert(binary_data.end(), overrides_data.begin(), overrides_data.end());
+   }
+   return basic_evm_tester::push_action(evm_account_name, "execbatch"_n, evm_account_name, bytes{binary_data.begin(), binary_data.end()});
+}
+
+transaction_trace_ptr basic_evm_tester::estimategas(const exec_input& input, const std::optional<std::vector<state_override>>& overrides) {
+   auto binary_data = fc::raw::pack(input);
+   if (overrides.has_value()) {
+      auto overrides_data = fc::raw::pack(*overrides);
+      binary_data.insert(binary_data.end(), overrides_data.begin(), overrides_data.end());
+   }
+   return basic_evm_tester::push_action(evm_account_name, "estimategas"_n, evm_account_name, bytes{binary_data.begin(), binary_data.end()});
+}
+
 transaction_trace_ptr basic_evm_tester::call(name from, const evmc::bytes& to, const evmc::bytes& value, evmc::bytes& data, uint64_t gas_limit, name actor)
 {
    bytes to_bytes;
@@ -384,12 +476,15 @@ transaction_trace_ptr basic_evm_tester::admincall(const evmc::bytes& from, const
    return push_action(evm_account_name, "admincall"_n, actor,  mvo()("from", from_bytes)("to", to_bytes)("value", value_bytes)("data", data_bytes)("gas_limit", gas_limit));
 }
 
-transaction_trace_ptr basic_evm_tester::bridgereg(name receiver, name handler, asset min_fee, vector<account_name> extra_signers) {
+transaction_trace_ptr basic_evm_tester::bridgereg(name receiver, name handler, asset min_fee, vector<account_name> extra_signers,
+                                                  std::optional<uint32_t> max_queued) {
    extra_signers.push_back(receiver);
    if (receiver != handler)
       extra_signers.push_back(handler);
-   return basic_evm_tester::push_action(evm_account_name, "bridgereg"_n, extra_signers, 
-      mvo()("receiver", receiver)("handler", handler)("min_fee", min_fee));
+   auto args = mvo()("receiver", receiver)("handler", handler)("min_fee", min_fee);
+   if (max_queued)
+      args("max_queued", *max_queued);
+   return basic_evm_tester::push_action(evm_account_name, "bridgereg"_n, extra_signers, args);
 }
 
 transaction_trace_ptr basic_evm_tester::bridgeunreg(name receiver) {
@@ -397,6 +492,16 @@ transaction_trace_ptr basic_evm_tester::bridgeunreg(name receiver) {
       mvo()("receiver", receiver));
 }
 
+transaction_trace_ptr basic_evm_tester::processq(name receiver, uint32_t max, name actor) {
+   return basic_evm_tester::push_action(evm_account_name, "processq"_n, actor,
+      mvo()("receiver", receiver)("max", max));
+}
+
+transaction_trace_ptr basic_evm_tester::dropmsg(name receiver, uint64_t id, name actor) {
+   return basic_evm_tester::push_action(evm_account_name, "dropmsg"_n, actor,
+      mvo()("receiver", receiver)("id", id));
+}
+
 transaction_trace_ptr basic_evm_tester::assertnonce(name account, uint64_t next_nonce) {
    return basic_evm_tester::push_action(evm_account_name, "assertnonce"_n, account, 
       mvo()("account", account)("next_nonce", next_nonce));
@@ -414,6 +519,33 @@ transaction_trace_ptr basic_evm_tester::pushtx(const silkworm::Transaction& trx,
    return push_action(evm_account_name, "pushtx"_n, miner, mvo()("miner", miner)("rlptx", rlp_bytes));
 }
 
+transaction_trace_ptr basic_evm_tester::pushtxs(const std::vector<silkworm::Transaction>& trxs, name miner)
+{
+   std::vector<bytes> rlptxs;
+   for (const auto& trx : trxs) {
+      silkworm::Bytes rlp;
+      silkworm::rlp::encode(rlp, trx);
+      rlptxs.emplace_back(rlp.begin(), rlp.end());
+   }
+
+   return push_action(evm_account_name, "pushtxs"_n, miner, mvo()("miner", miner)("rlptxs", rlptxs));
+}
+
+transaction_trace_ptr basic_evm_tester::batchdeposit(name from, const std::vector<std::pair<evmc::address, asset>>& deposits)
+{
+   fc::variants entries;
+   for (const auto& [to, quantity] : deposits) {
+      entries.emplace_back(mvo()("to", bytes{to.bytes, to.bytes + sizeof(to.bytes)})("quantity", quantity));
+   }
+
+   return push_action(evm_account_name, "batchdeposit"_n, from, mvo()("from", from)("deposits", entries));
+}
+
+transaction_trace_ptr basic_evm_tester::setgcbudget(uint32_t budget, name actor) {
+   return basic_evm_tester::push_action(evm_account_name, "setgcbudget"_n, actor,
+      mvo()("budget", budget));
+}
+
 transaction_trace_ptr basic_evm_tester::setversion(uint64_t version, name actor) {
    return basic_evm_tester::push_action(evm_account_name, "setversion"_n, actor,
       mvo()("version", version));
@@ -439,6 +571,11 @@ transaction_trace_ptr basic_evm_tester::freezeaccnt(uint64_t id, bool value, nam
       mvo()("id", id)("value",value));
 }
 
+transaction_trace_ptr basic_evm_tester::mklegacy(uint64_t id) {
+   return basic_evm_tester::push_action(evm_account_name, "mklegacy"_n, evm_account_name,
+      mvo()("id", id));
+}
+
 transaction_trace_ptr basic_evm_tester::addevmbal(uint64_t id, const intx::uint256& delta, bool subtract, name actor) {
    auto d = to_bytes(delta);
    return basic_evm_tester::push_action(evm_account_name, "addevmbal"_n, actor,
@@ -498,6 +635,17 @@ void basic_evm_tester::gc(uint32_t max) {
    push_action(evm_account_name, "gc"_n, evm_account_name, mvo()("max", max));
 }
 
+bool basic_evm_tester::gcrange(uint64_t id, uint64_t lower, uint64_t upper, uint32_t max, name actor) {
+   auto trace = push_action(evm_account_name, "gcrange"_n, actor,
+      mvo()("id", id)("lower", lower)("upper", upper)("max", max));
+   return fc::raw::unpack<bool>(trace->action_traces[0].return_value);
+}
+
+bool basic_evm_tester::migstorage(uint32_t max) {
+   auto trace = push_action(evm_account_name, "migstorage"_n, evm_account_name, mvo()("max", max));
+   return fc::raw::unpack<bool>(trace->action_traces[0].return_value);
+}
+
 balance_and_dust basic_evm_tester::vault_balance(name owner) const
 {
    const vector<char> d = get_row_by_account(evm_account_name, evm_account_name, "balances"_n, owner);
@@ -542,7 +690,8 @@ std::optional<account_object> convert_to_account_object(const partial_account_ta
       .nonce = row.nonce,
       .balance = intx::be::unsafe::load<intx::uint256>(reinterpret_cast<const uint8_t*>(row.balance.data())),
       .code_id = row.code_id,
-      .flags = row.flags
+      .flags = row.flags,
+      .code_hash = row.code_hash
    };
 }
 
@@ -641,9 +790,29 @@ std::optional<account_object> basic_evm_tester::find_account_by_id(uint64_t id)
 bool basic_evm_tester::scan_account_storage(uint64_t account_id, std::function<bool(storage_slot)> visitor) const
 {
    static constexpr eosio::chain::name storage_table_name = "storage"_n;
+   static constexpr eosio::chain::name storage2_table_name = "storage2"_n;
 
    bool successful = true;
+   bool done = false;
+
+   scan_table<storage2_table_row>(
+      storage2_table_name, name{account_id}, [&visitor, &done](storage2_table_row&& row) {
+         if (row.value == fc::sha256()) {
+            // tombstone left on a probe chain
+            return false;
+         }
+         done = visitor(storage_slot{
+            .id = row.id,
+            .key = intx::be::unsafe::load<intx::uint256>(reinterpret_cast<const uint8_t*>(row.key.data())),
+            .value = intx::be::unsafe::load<intx::uint256>(reinterpret_cast<const uint8_t*>(row.value.data()))});
+         return done;
+      });
+
+   if (done) {
+      return successful;
+   }
 
+   // Rows of accounts not yet migrated by migstorage
    scan_table<storage_table_row>(
       storage_table_name, name{account_id}, [&visitor, &successful](storage_table_row&& row) {
          if (row.key.size() != 32 || row.value.size() != 32) {
@@ -659,6 +828,17 @@ bool basic_evm_tester::scan_account_storage(uint64_t account_id, std::function<b
    return successful;
 }
 
+size_t basic_evm_tester::legacy_storage_rows(uint64_t account_id) const
+{
+   size_t total = 0;
+   scan_table<storage_table_row>(
+      "storage"_n, name{account_id}, [&total](storage_table_row&&) {
+         ++total;
+         return false;
+      });
+   return total;
+}
+
 void basic_evm_tester::scan_balances(std::function<bool(vault_balance_row)> visitor) const {
    static constexpr eosio::chain::name balances_table_name = "balances"_n;
    scan_table<vault_balance_row>(
@@ -695,6 +875,14 @@ asset basic_evm_tester::get_eos_balance( const account_name& act ) {
    return data.empty() ? asset(0, native_symbol) : fc::raw::unpack<asset>(data);
 }
 
+void basic_evm_tester::record_timings(const transaction_trace_ptr& trace) {
+   for (const auto& at : trace->action_traces) {
+      if (at.receiver == at.act.account) {
+         action_timings[at.act.name].push_back(at.elapsed.count());
+      }
+   }
+}
+
 void basic_evm_tester::check_balances() {
    intx::uint256 total_in_evm_accounts;
    scan_accounts([&](evm_test::account_object&& account) -> bool {
@@ -75,6 +75,7 @@ struct config_table_row
    uint32_t miner_cut;
    uint32_t status;
    std::optional<evm_version_type> evm_version;
+   std::optional<uint32_t> gc_budget;
 };
 
 struct config2_table_row
@@ -96,7 +97,8 @@ struct balance_and_dust
 struct account_object
 {
    enum class flag : uint32_t {
-      frozen = 0x1
+      frozen = 0x1,
+      storage_v2 = 0x2
    };
 
    uint64_t id;
@@ -105,6 +107,7 @@ struct account_object
    intx::uint256 balance;
    std::optional<uint64_t> code_id;
    std::optional<uint32_t> flags;
+   std::optional<fc::sha256> code_hash;
 
    inline bool has_flag(flag f)const {
       return (flags.has_value() && (flags.value() & static_cast<uint32_t>(f)) != 0);
@@ -145,11 +148,31 @@ struct exec_output {
    std::optional<bytes> context;
 };
 
+// exec_output as returned by the contract, with its gas_used extension
+struct exec_output_with_gas : exec_output {
+   uint64_t gas_used;
+};
+
+struct storage_override {
+   bytes key;
+   bytes value;
+};
+
+struct state_override {
+   bytes                         address;
+   std::optional<bytes>          balance;
+   std::optional<uint64_t>       nonce;
+   std::optional<bytes>          code;
+   std::vector<storage_override> storage;
+};
+
 struct message_receiver {
     name     account;
     name     handler;
     asset    min_fee;
     uint32_t flags;
+    uint32_t max_queued;
+    uint32_t queued;
 };
 
 struct bridge_message_v0 {
@@ -177,7 +200,7 @@ using bridge_message = std::variant<bridge_message_v0>;
 } // namespace evm_test
 
 
-FC_REFLECT(evm_test::config_table_row, (version)(chainid)(genesis_time)(ingress_bridge_fee)(gas_price)(miner_cut)(status)(evm_version))
+FC_REFLECT(evm_test::config_table_row, (version)(chainid)(genesis_time)(ingress_bridge_fee)(gas_price)(miner_cut)(status)(evm_version)(gc_budget))
 FC_REFLECT(evm_test::evm_version_type, (pending_version)(cached_version))
 FC_REFLECT(evm_test::evm_version_type::pending, (version)(time))
 FC_REFLECT(evm_test::config2_table_row,(next_account_id))
@@ -189,8 +212,11 @@ FC_REFLECT(evm_test::fee_parameters, (gas_price)(miner_cut)(ingress_bridge_fee))
 FC_REFLECT(evm_test::exec_input, (context)(from)(to)(data)(value))
 FC_REFLECT(evm_test::exec_callback, (contract)(action))
 FC_REFLECT(evm_test::exec_output, (status)(data)(context))
+FC_REFLECT_DERIVED(evm_test::exec_output_with_gas, (evm_test::exec_output), (gas_used))
+FC_REFLECT(evm_test::storage_override, (key)(value))
+FC_REFLECT(evm_test::state_override, (address)(balance)(nonce)(code)(storage))
 
-FC_REFLECT(evm_test::message_receiver, (account)(handler)(min_fee)(flags));
+FC_REFLECT(evm_test::message_receiver, (account)(handler)(min_fee)(flags)(max_queued)(queued));
 FC_REFLECT(evm_test::bridge_message_v0, (receiver)(sender)(timestamp)(value)(data));
 FC_REFLECT(evm_test::gcstore, (id)(storage_id));
 FC_REFLECT(evm_test::account_code, (id)(ref_count)(code)(code_hash));
@@ -357,6 +383,11 @@ public:
    static evmc::address make_reserved_address(uint64_t account);
    static evmc::address make_reserved_address(name account);
 
+   /// Home primary key of a slot in the storage2 table, same as storage2_key in the contract
+   static uint64_t storage2_home_key(const intx::uint256& slot);
+   /// A slot (different for each tag) whose storage2 home primary key is `home`
+   static intx::uint256 storage2_slot_with_home_key(uint64_t home, uint64_t tag);
+
    explicit basic_evm_tester(std::string native_symbol_str = "4,EOS");
 
    asset make_asset(int64_t amount) const;
@@ -394,12 +425,22 @@ public:
    silkworm::Transaction
    generate_tx(const evmc::address& to, const intx::uint256& value, uint64_t gas_limit = 21000) const;
 
-   transaction_trace_ptr bridgereg(name receiver, name handler, asset min_fee, vector<account_name> extra_signers={evm_account_name});
+   transaction_trace_ptr bridgereg(name receiver, name handler, asset min_fee, vector<account_name> extra_signers={evm_account_name},
+                                   std::optional<uint32_t> max_queued={});
    transaction_trace_ptr bridgeunreg(name receiver);
-   transaction_trace_ptr exec(const exec_input& input, const std::optional<exec_callback>& callback);
+   transaction_trace_ptr processq(name receiver, uint32_t max, name actor = evm_account_name);
+   transaction_trace_ptr dropmsg(name receiver, uint64_t id, name actor);
+   transaction_trace_ptr exec(const exec_input& input, const std::optional<exec_callback>& callback,
+                              const std::optional<std::vector<state_override>>& overrides = {});
+   transaction_trace_ptr execbatch(const std::vector<exec_input>& inputs,
+                                   const std::optional<std::vector<state_override>>& overrides = {});
+   transaction_trace_ptr estimategas(const exec_input& input, const std::optional<std::vector<state_override>>& overrides = {});
    transaction_trace_ptr assertnonce(name account, uint64_t next_nonce);
    transaction_trace_ptr pushtx(const silkworm::Transaction& trx, name miner = evm_account_name);
+   transaction_trace_ptr pushtxs(const std::vector<silkworm::Transaction>& trxs, name miner = evm_account_name);
+   transaction_trace_ptr batchdeposit(name from, const std::vector<std::pair<evmc::address, asset>>& deposits);
    transaction_trace_ptr setversion(uint64_t version, name actor);
+   transaction_trace_ptr setgcbudget(uint32_t budget, name actor = evm_account_name);
    transaction_trace_ptr call(name from, const evmc::bytes& to, const evmc::bytes& value, evmc::bytes& data, uint64_t gas_limit, name actor);
    transaction_trace_ptr admincall(const evmc::bytes& from, const evmc::bytes& to, const evmc::bytes& value, evmc::bytes& data, uint64_t gas_limit, name actor);
    evmc::address deploy_contract(evm_eoa& eoa, evmc::bytes bytecode);
@@ -411,6 +452,7 @@ public:
    transaction_trace_ptr setkvstore(uint64_t account_id, const bytes& key, const std::optional<bytes>& value, name actor=evm_account_name);
    transaction_trace_ptr rmaccount(uint64_t id, name actor=evm_account_name);
    transaction_trace_ptr freezeaccnt(uint64_t id, bool value, name actor=evm_account_name);
+   transaction_trace_ptr mklegacy(uint64_t id);
    transaction_trace_ptr addevmbal(uint64_t id, const intx::uint256& delta, bool subtract, name actor=evm_account_name);
    transaction_trace_ptr addopenbal(name account, const intx::uint256& delta, bool subtract, name actor=evm_account_name);
 
@@ -420,6 +462,8 @@ public:
 
    balance_and_dust inevm() const;
    void gc(uint32_t max);
+   bool migstorage(uint32_t max);
+   bool gcrange(uint64_t id, uint64_t lower, uint64_t upper, uint32_t max, name actor = evm_account_name);
    balance_and_dust vault_balance(name owner) const;
    std::optional<intx::uint256> evm_balance(const evmc::address& address) const;
    std::optional<intx::uint256> evm_balance(const evm_eoa& account) const;
@@ -428,6 +472,12 @@ public:
 
    void check_balances();
 
+   // Time spent by the node in each action, by action name. Per stage timings are
+   // out of scope here: a contract has no clock, and the EVM STAGE lines of a
+   // WITH_LOGTIME build only reach the node log, not the transaction traces.
+   std::map<name, std::vector<int64_t>> action_timings;
+   void record_timings(const transaction_trace_ptr& trace);
+
    template <typename T, typename Visitor>
    void scan_table(eosio::chain::name table_name, eosio::chain::name scope_name, Visitor&& visitor) const
    {
@@ -458,6 +508,7 @@ public:
    std::optional<account_object> find_account_by_address(const evmc::address& address) const;
    std::optional<account_object> find_account_by_id(uint64_t id) const;
    bool scan_account_storage(uint64_t account_id, std::function<bool(storage_slot)> visitor) const;
+   size_t legacy_storage_rows(uint64_t account_id) const;
    bool scan_gcstore(std::function<bool(gcstore)> visitor) const;
    bool scan_account_code(std::function<bool(account_code)> visitor) const;
    void scan_balances(std::function<bool(evm_test::vault_balance_row)> visitor) const;
@@ -12,6 +12,13 @@ using eosio::testing::expect_assert_message;
 struct bridge_message_tester : basic_evm_tester {
 
     static constexpr const char* bridgeMsgV0_method_id = "f781185b";
+    static constexpr const char* bridgeMsgV1_method_id = "60e9fbd3";
+
+    struct message_v1_entry {
+      std::string   receiver;
+      intx::uint256 value;
+      std::string   data; // hex
+    };
 
     bridge_message_tester() {
       create_accounts({"alice"_n});
@@ -67,6 +74,51 @@ struct bridge_message_tester : basic_evm_tester {
       return send_raw_message(eoa, make_reserved_address(evm_account_name), value, data);
     }
 
+    // bridgeMsgV1(bool,(string,uint256,bytes)[]), sends the sum of the entry values unless value is given
+    transaction_trace_ptr send_bridge_message_v1(evm_eoa& eoa, bool atomic, const std::vector<message_v1_entry>& entries,
+                                                 std::optional<intx::uint256> value = {}) {
+      auto word = [](const intx::uint256& v) {
+        silkworm::Bytes w(32, 0);
+        intx::be::unsafe::store(w.data(), v);
+        return w;
+      };
+      auto padded = [](silkworm::Bytes b) {
+        b.resize((b.size() + 31) / 32 * 32);
+        return b;
+      };
+
+      intx::uint256 total;
+      std::vector<silkworm::Bytes> tuples;
+      for (const auto& e : entries) {
+        silkworm::Bytes account{(const uint8_t*)e.receiver.data(), e.receiver.size()};
+        auto payload = evmc::from_hex(e.data).value();
+
+        silkworm::Bytes t;
+        t += word(96);                                     //offset of receiver
+        t += word(e.value);                                //value
+        t += word(128 + padded(account).size());           //offset of data
+        t += word(account.size()) + padded(account);
+        t += word(payload.size()) + padded(payload);
+        tuples.push_back(t);
+        total += e.value;
+      }
+
+      silkworm::Bytes data = evmc::from_hex(bridgeMsgV1_method_id).value();
+      data += word(atomic ? 1 : 0);
+      data += word(64);                                    //offset of entries
+      data += word(entries.size());
+      uint64_t offset = entries.size() * 32;
+      for (const auto& t : tuples) {
+        data += word(offset);
+        offset += t.size();
+      }
+      for (const auto& t : tuples) {
+        data += t;
+      }
+
+      return send_raw_message(eoa, make_reserved_address(evm_account_name), value.value_or(total), data);
+    }
+
     transaction_trace_ptr send_raw_message(evm_eoa& eoa, const evmc::address& dest, const intx::uint256& value, const silkworm::Bytes& data) {
       auto txn = generate_tx(dest, value, 250'000);
       txn.data = data;
@@ -98,14 +150,17 @@ BOOST_FIXTURE_TEST_CASE(bridge_register_test, bridge_message_tester) try {
   BOOST_REQUIRE(row.account == "rec1"_n);
   BOOST_REQUIRE(row.min_fee == make_asset(0));
   BOOST_REQUIRE(row.flags == 0x1);
+  BOOST_REQUIRE(row.max_queued == 0);
+  BOOST_REQUIRE(row.queued == 0);
 
-  // Register again changing min fee
-  bridgereg("rec1"_n, "rec1"_n, make_asset(1));
+  // Register again changing min fee and accepting queued messages
+  bridgereg("rec1"_n, "rec1"_n, make_asset(1), {evm_account_name}, 5);
 
   row = fc::raw::unpack<message_receiver>(get_row_by_account( evm_account_name, evm_account_name, "msgreceiver"_n, "rec1"_n));
   BOOST_REQUIRE(row.account == "rec1"_n);
   BOOST_REQUIRE(row.min_fee == make_asset(1));
   BOOST_REQUIRE(row.flags == 0x1);
+  BOOST_REQUIRE(row.max_queued == 5);
 
   // Unregister rec1
   bridgeunreg("rec1"_n);
@@ -385,4 +440,212 @@ BOOST_FIXTURE_TEST_CASE(handler_tests, bridge_message_tester) try {
 
 } FC_LOG_AND_RETHROW()
 
+
+BOOST_FIXTURE_TEST_CASE(abi_decoder_bounds, bridge_message_tester) try {
+
+  auto emv_reserved_address = make_reserved_address(evm_account_name);
+
+  evm_eoa evm1;
+  transfer_token("alice"_n, evm_account_name, make_asset(100'0000), evm1.address_0x());
+
+  auto word = [](const intx::uint256& v) {
+    silkworm::Bytes w(32, 0);
+    intx::be::unsafe::store(w.data(), v);
+    return w;
+  };
+  auto v1_head = [&](const intx::uint256& entries_offset) {
+    return evmc::from_hex(bridgeMsgV1_method_id).value() + word(1) + word(entries_offset);
+  };
+
+  // Fewer than 4 bytes of calldata
+  BOOST_REQUIRE_EXCEPTION(send_raw_message(evm1, emv_reserved_address, 0, evmc::from_hex("60e9fb").value()),
+    eosio_assert_message_exception, eosio_assert_message_is("datastream attempted to read past the end"));
+  evm1.next_nonce--;
+
+  // Offset of the entries past the end of the arguments
+  BOOST_REQUIRE_EXCEPTION(send_raw_message(evm1, emv_reserved_address, 0, v1_head(0x1000)),
+    eosio_assert_message_exception, eosio_assert_message_is("datastream attempted to read past the end"));
+  evm1.next_nonce--;
+
+  // Offset word that does not fit in 32 bits
+  BOOST_REQUIRE_EXCEPTION(send_raw_message(evm1, emv_reserved_address, 0, v1_head(intx::uint256(1) << 255)),
+    eosio_assert_message_exception, eosio_assert_message_is("invalid length"));
+  evm1.next_nonce--;
+
+  // Entry count of 2^32
+  BOOST_REQUIRE_EXCEPTION(send_raw_message(evm1, emv_reserved_address, 0, v1_head(64) + word(intx::uint256(1) << 32)),
+    eosio_assert_message_exception, eosio_assert_message_is("invalid length"));
+  evm1.next_nonce--;
+
+  // Entry count larger than the entries actually encoded
+  BOOST_REQUIRE_EXCEPTION(send_raw_message(evm1, emv_reserved_address, 0, v1_head(64) + word(1000)),
+    eosio_assert_message_exception, eosio_assert_message_is("datastream attempted to read past the end"));
+  evm1.next_nonce--;
+
+  // Data cut off before its padding: 4 bytes of data without the 28 bytes padding them to a word
+  BOOST_REQUIRE_EXCEPTION(send_raw_message(evm1, emv_reserved_address, 0,
+                                           evmc::from_hex(bridgeMsgV0_method_id).value() +
+                                           evmc::from_hex(int_str32(96)).value() +
+                                           evmc::from_hex(int_str32(1)).value() +
+                                           evmc::from_hex(int_str32(160)).value() +
+                                           evmc::from_hex(int_str32(4)).value() +
+                                           evmc::from_hex(data_str32(str_to_hex("abcd"))).value() +
+                                           evmc::from_hex(int_str32(4)).value() +
+                                           evmc::from_hex(str_to_hex("data")).value()),
+    eosio_assert_message_exception, eosio_assert_message_is("datastream attempted to read past the end"));
+  evm1.next_nonce--;
+
+  // Length of the account string running past the end
+  BOOST_REQUIRE_EXCEPTION(send_raw_message(evm1, emv_reserved_address, 0,
+                                           evmc::from_hex(bridgeMsgV0_method_id).value() +
+                                           evmc::from_hex(int_str32(96)).value() +
+                                           evmc::from_hex(int_str32(1)).value() +
+                                           evmc::from_hex(int_str32(160)).value() +
+                                           evmc::from_hex(int_str32(0x10000)).value()),
+    eosio_assert_message_exception, eosio_assert_message_is("datastream attempted to read past the end"));
+  evm1.next_nonce--;
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(message_v1_tests, bridge_message_tester) try {
+
+  create_accounts({"rec1"_n, "rec2"_n});
+  for (auto rec : {"rec1"_n, "rec2"_n}) {
+    set_code(rec, testing::contracts::evm_bridge_receiver_wasm());
+    set_abi(rec, testing::contracts::evm_bridge_receiver_abi().data());
+  }
+  bridgereg("rec1"_n, "rec1"_n, make_asset(1'0000), {evm_account_name}, 2);
+  bridgereg("rec2"_n, "rec2"_n, make_asset(0));
+
+  evm_eoa evm1;
+  transfer_token("alice"_n, evm_account_name, make_asset(100'0000), evm1.address_0x());
+
+  auto queued = [&](name receiver) {
+    return fc::raw::unpack<message_receiver>(get_row_by_account(evm_account_name, evm_account_name, "msgreceiver"_n, receiver)).queued;
+  };
+
+  auto check_message = [&](const auto& at, name receiver, const intx::uint256& value, const std::string& data) {
+    BOOST_REQUIRE(at.receiver == receiver);
+    auto out = std::get<bridge_message_v0>(fc::raw::unpack<bridge_message>(at.return_value));
+    BOOST_CHECK(out.receiver == receiver);
+    BOOST_CHECK(out.sender == to_bytes(evm1.address));
+    BOOST_CHECK(out.value == to_bytes(value));
+    BOOST_CHECK(out.data == to_bytes(evmc::from_hex(data).value()));
+  };
+
+  // Entry values must add up to the value of the message
+  BOOST_REQUIRE_EXCEPTION(send_bridge_message_v1(evm1, true, {{"rec1", 1_ether, "01"}}, 2_ether),
+    eosio_assert_message_exception, eosio_assert_message_is("invalid message value"));
+  evm1.next_nonce--;
+
+  // min_fee applies to each entry
+  BOOST_REQUIRE_EXCEPTION(send_bridge_message_v1(evm1, true, {{"rec2", 1_ether, "01"}, {"rec1", 0, "02"}}),
+    eosio_assert_message_exception, eosio_assert_message_is("min_fee not covered"));
+  evm1.next_nonce--;
+
+  BOOST_REQUIRE_EXCEPTION(send_bridge_message_v1(evm1, true, {}),
+    eosio_assert_message_exception, eosio_assert_message_is("empty bridge message"));
+  evm1.next_nonce--;
+
+  // Atomic delivery: one onbridgemsg per entry, in order
+  auto res = send_bridge_message_v1(evm1, true, {{"rec1", 2_ether, "01"}, {"rec2", 0, "02"}, {"rec1", 1_ether, "03"}});
+  BOOST_REQUIRE(res->action_traces.size() == 4);
+  check_message(res->action_traces[1], "rec1"_n, 2_ether, "01");
+  check_message(res->action_traces[2], "rec2"_n, 0, "02");
+  check_message(res->action_traces[3], "rec1"_n, 1_ether, "03");
+  BOOST_REQUIRE(vault_balance("rec1"_n) == (balance_and_dust{make_asset(3'0000), 0}));
+
+  // Non-atomic delivery is opt-in, rec2 registered without a queue
+  BOOST_REQUIRE_EXCEPTION(send_bridge_message_v1(evm1, false, {{"rec2", 1_ether, "05"}}),
+    eosio_assert_message_exception, eosio_assert_message_is("receiver does not accept queued messages"));
+  evm1.next_nonce--;
+  bridgereg("rec2"_n, "rec2"_n, make_asset(0), {evm_account_name}, 1);
+
+  // Non-atomic delivery: value is credited right away, messages are queued
+  res = send_bridge_message_v1(evm1, false, {{"rec1", 1_ether, "04"}, {"rec2", 1_ether, "05"}});
+  BOOST_REQUIRE(res->action_traces.size() == 1);
+  BOOST_REQUIRE(vault_balance("rec1"_n) == (balance_and_dust{make_asset(4'0000), 0}));
+  BOOST_REQUIRE(vault_balance("rec2"_n) == (balance_and_dust{make_asset(1'0000), 0}));
+
+  // The queue of a receiver is bounded by its registration
+  BOOST_REQUIRE_EXCEPTION(send_bridge_message_v1(evm1, false, {{"rec2", 0, "07"}}),
+    eosio_assert_message_exception, eosio_assert_message_is("receiver queue is full"));
+  evm1.next_nonce--;
+  BOOST_REQUIRE_EXCEPTION(send_bridge_message_v1(evm1, false, {{"rec1", 1_ether, "06"}, {"rec1", 1_ether, "07"}}),
+    eosio_assert_message_exception, eosio_assert_message_is("receiver queue is full"));
+  evm1.next_nonce--;
+
+  BOOST_REQUIRE_EXCEPTION(bridgeunreg("rec2"_n),
+    eosio_assert_message_exception, eosio_assert_message_is("receiver has queued messages"));
+
+  // Each receiver has its own queue
+  res = send_bridge_message_v1(evm1, false, {{"rec1", 1_ether, "06"}});
+  BOOST_REQUIRE(queued("rec1"_n) == 2);
+  BOOST_REQUIRE(queued("rec2"_n) == 1);
+  res = processq("rec1"_n, 1);
+  BOOST_REQUIRE(res->action_traces.size() == 2);
+  BOOST_REQUIRE(!fc::raw::unpack<bool>(res->action_traces[0].return_value));
+  check_message(res->action_traces[1], "rec1"_n, 1_ether, "04");
+  BOOST_REQUIRE(queued("rec1"_n) == 1);
+  produce_block();
+
+  // The receiver can process its own queue
+  res = processq("rec1"_n, 10, "rec1"_n);
+  BOOST_REQUIRE(res->action_traces.size() == 2);
+  BOOST_REQUIRE(fc::raw::unpack<bool>(res->action_traces[0].return_value));
+  check_message(res->action_traces[1], "rec1"_n, 1_ether, "06");
+
+  BOOST_REQUIRE_EXCEPTION(processq("rec2"_n, 10, "rec1"_n),
+    missing_auth_exception, eosio::testing::fc_exception_message_starts_with("missing authority"));
+
+  res = processq("rec2"_n, 10);
+  BOOST_REQUIRE(res->action_traces.size() == 2);
+  BOOST_REQUIRE(fc::raw::unpack<bool>(res->action_traces[0].return_value));
+  check_message(res->action_traces[1], "rec2"_n, 1_ether, "05");
+  BOOST_REQUIRE(queued("rec1"_n) == 0);
+  BOOST_REQUIRE(queued("rec2"_n) == 0);
+  bridgeunreg("rec2"_n);
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(failing_queued_handler, bridge_message_tester) try {
+
+  // The contract of bad has no onbridgemsg action, every delivery to it fails
+  create_accounts({"rec1"_n, "bad"_n});
+  set_code("rec1"_n, testing::contracts::evm_bridge_receiver_wasm());
+  set_abi("rec1"_n, testing::contracts::evm_bridge_receiver_abi().data());
+  set_code("bad"_n, testing::contracts::evm_read_callback_wasm());
+  bridgereg("rec1"_n, "rec1"_n, make_asset(0), {evm_account_name}, 10);
+  bridgereg("bad"_n, "bad"_n, make_asset(0), {evm_account_name}, 10);
+
+  evm_eoa evm1;
+  transfer_token("alice"_n, evm_account_name, make_asset(100'0000), evm1.address_0x());
+
+  send_bridge_message_v1(evm1, false, {{"bad", 1_ether, "01"}, {"rec1", 0, "02"}, {"bad", 0, "03"}});
+  BOOST_REQUIRE(vault_balance("bad"_n) == (balance_and_dust{make_asset(1'0000), 0}));
+
+  BOOST_REQUIRE_THROW(processq("bad"_n, 1), fc::exception);
+  produce_block();
+
+  // Other receivers are not held up
+  auto res = processq("rec1"_n, 10);
+  BOOST_REQUIRE(res->action_traces.size() == 2);
+  BOOST_REQUIRE(fc::raw::unpack<bool>(res->action_traces[0].return_value));
+  BOOST_REQUIRE(res->action_traces[1].receiver == "rec1"_n);
+
+  // Only the receiver can drop its messages, the value stays credited
+  BOOST_REQUIRE_EXCEPTION(dropmsg("bad"_n, 0, evm_account_name),
+    missing_auth_exception, eosio::testing::fc_exception_message_starts_with("missing authority"));
+  BOOST_REQUIRE_EXCEPTION(dropmsg("bad"_n, 5, "bad"_n),
+    eosio_assert_message_exception, eosio_assert_message_is("message not found"));
+  dropmsg("bad"_n, 0, "bad"_n);
+  dropmsg("bad"_n, 1, "bad"_n);
+  BOOST_REQUIRE(vault_balance("bad"_n) == (balance_and_dust{make_asset(1'0000), 0}));
+
+  res = processq("bad"_n, 10);
+  BOOST_REQUIRE(res->action_traces.size() == 1);
+  BOOST_REQUIRE(fc::raw::unpack<bool>(res->action_traces[0].return_value));
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -329,32 +329,22 @@ struct account_code {
 FC_REFLECT(account_code, (id)(ref_count)(code)(code_hash));
 
 struct storage {
-   uint64_t id;
-   bytes    key;
-   bytes    value;
-
-   struct by_key {
-      typedef index256_object index_object;
-      static name index_name() {
-         return storage::index_name("by.key"_n);
-      }
-   };
+   uint64_t    id;
+   fc::sha256  key;
+   fc::sha256  value;
 
    evmc::bytes32 get_value() {
       evmc::bytes32 res;
-      memcpy(res.bytes, value.data(), value.size());
+      memcpy(res.bytes, value.data(), sizeof(res.bytes));
       return res;
    }
 
-   static name table_name() { return "storage"_n; }
-   static name index_name(const name& n) {
-      uint64_t index_table_name = table_name().to_uint64_t() & 0xFFFFFFFFFFFFFFF0ULL;
-
-      //0=>by.key
-      if( n == "by.key"_n ) {
-         return name{index_table_name | 0};
-      }
+   bool is_tombstone()const {
+      return value == fc::sha256();
+   }
 
+   static name table_name() { return "storage2"_n; }
+   static name index_name(const name& n) {
       BOOST_REQUIRE(false);
       return name{0};
    }
@@ -363,8 +353,37 @@ struct storage {
       return index_name(name{n});
    }
 
+   // Same as storage2_key in the contract: splitmix64 finalizer folded over the four big endian words of the slot
+   static uint64_t home_key(const evmc::bytes32& key) {
+      auto mix64 = [](uint64_t x) {
+         x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+         x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+         return x ^ (x >> 31);
+      };
+      uint64_t res = 0;
+      for(size_t i = 0; i < sizeof(key.bytes); i += 8) {
+         uint64_t word = 0;
+         for(size_t j = 0; j < 8; ++j) word = (word << 8) | key.bytes[i+j];
+         res = mix64(res ^ word);
+      }
+      return res;
+   }
+
    static std::optional<storage> get(chainbase::database& db, uint64_t account, const evmc::bytes32& key) {
-      return get_by_index<evmc::bytes32, storage>(db, name{account}, "by.key"_n, key);
+      const auto* tid = db.find<table_id_object, by_code_scope_table>(
+         boost::make_tuple("evm"_n, name{account}, table_name())
+      );
+      if(tid == nullptr) return {};
+
+      for(uint64_t pk = home_key(key);; ++pk) {
+         const auto* kv_obj = db.find<key_value_object, by_scope_primary>(
+            boost::make_tuple(tid->id, pk)
+         );
+         if(kv_obj == nullptr) return {};
+
+         auto r = fc::raw::unpack<storage>(kv_obj->value.data(), kv_obj->value.size());
+         if(memcmp(r.key.data(), key.bytes, sizeof(key.bytes)) == 0) return r;
+      }
    }
 
 };
@@ -780,7 +799,7 @@ struct evm_runtime_tester : eosio_system_tester, silkworm::State {
          // std::cout << fc::format_string("   ${a}=${b}", mu, true) << std::endl;
          
          ++itr;
-         ++count;
+         if(!r.is_tombstone()) ++count;
       }
       //dlog("${a} => ${c}",("a",to_bytes(address))("c",count));
       //std::cout << "   total: " << count << std::endl;
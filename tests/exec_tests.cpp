@@ -248,4 +248,225 @@ BOOST_FIXTURE_TEST_CASE(wrong_input_params, exec_evm_tester) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE(exec_batch, exec_evm_tester) try {
+
+  // Fund evm1 address with 100 EOS
+  evm_eoa evm1, evm2;
+  const int64_t to_bridge = 1000000;
+  transfer_token("alice"_n, "evm"_n, make_asset(to_bridge), evm1.address_0x());
+
+  auto token_addr = deploy_evm_token_contract(evm1);
+  erc20_transfer(token_addr, evm1, evm2, 1234);
+
+  auto balance_of = [&](const evm_eoa& account) {
+    silkworm::Bytes data;
+    data += evmc::from_hex("70a08231").value();   // sha3(balanceOf(address))[:4]
+    data += silkworm::to_bytes32(account.address);
+
+    exec_input input;
+    input.context = bytes{'b'};
+    input.to      = bytes{std::begin(token_addr.bytes), std::end(token_addr.bytes)};
+    input.data    = bytes{data.begin(), data.end()};
+    return input;
+  };
+
+  // A transfer in the middle of the batch is not seen by the next inputs
+  silkworm::Bytes data;
+  data += evmc::from_hex("a9059cbb").value();   // sha3(transfer(address,uint256))[:4]
+  data += silkworm::to_bytes32(evm2.address);   // to
+  data += evmc::bytes32{1111};                  // value
+
+  exec_input transfer;
+  transfer.from = bytes{std::begin(evm1.address.bytes), std::end(evm1.address.bytes)};
+  transfer.to   = bytes{std::begin(token_addr.bytes), std::end(token_addr.bytes)};
+  transfer.data = bytes{data.begin(), data.end()};
+
+  auto res = execbatch({balance_of(evm2), transfer, balance_of(evm2), balance_of(evm1)});
+  BOOST_REQUIRE(res->action_traces.size() == 1);
+
+  auto outs = fc::raw::unpack<std::vector<exec_output_with_gas>>(res->action_traces[0].return_value);
+  BOOST_REQUIRE(outs.size() == 4);
+  for (const auto& out : outs) {
+    BOOST_REQUIRE(out.status == 0);
+    BOOST_REQUIRE(out.data.size() == 32);
+    BOOST_REQUIRE(out.gas_used > 21000);
+  }
+  BOOST_REQUIRE(outs[0].context == bytes{'b'});
+  BOOST_REQUIRE(!outs[1].context.has_value());
+
+  auto balance = [](const exec_output& out) {
+    return intx::be::unsafe::load<intx::uint256>(reinterpret_cast<const uint8_t*>(out.data.data()));
+  };
+  BOOST_REQUIRE(balance(outs[0]) == 1234);
+  BOOST_REQUIRE(balance(outs[2]) == 1234);
+  BOOST_REQUIRE(balance(outs[3]) == 1000000000000000000000000_u256 - 1234);
+
+  BOOST_REQUIRE_EXCEPTION(execbatch({}),
+                          eosio_assert_message_exception, eosio_assert_message_is("no inputs"));
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(exec_with_state_overrides, exec_evm_tester) try {
+
+  evm_eoa evm2;
+
+  // sload(calldata[0:32]) returned as a word: 600035 54 600052 6020 6000 f3
+  const auto sload_code = evmc::from_hex("6000355460005260206000f3").value();
+  evm_eoa code_holder;
+  const bytes holder_addr{std::begin(code_holder.address.bytes), std::end(code_holder.address.bytes)};
+
+  evmc::bytes32 slot{7};
+  evmc::bytes32 value{42};
+
+  exec_input input;
+  input.to   = holder_addr;
+  input.data = bytes{std::begin(slot.bytes), std::end(slot.bytes)};
+
+  state_override code_override{
+    .address = holder_addr,
+    .code    = bytes{sload_code.begin(), sload_code.end()},
+    .storage = {{bytes{std::begin(slot.bytes), std::end(slot.bytes)}, bytes{std::begin(value.bytes), std::end(value.bytes)}}}
+  };
+
+  // The account has no code on chain, the call only sees the overridden one
+  auto res = exec(input, {}, std::vector<state_override>{code_override});
+  auto out = fc::raw::unpack<exec_output_with_gas>(res->action_traces[0].return_value);
+  BOOST_REQUIRE(out.status == 0);
+  BOOST_REQUIRE(out.data == bytes(std::begin(value.bytes), std::end(value.bytes)));
+  BOOST_REQUIRE(out.gas_used > 21000);
+  BOOST_REQUIRE(!find_account_by_address(code_holder.address));
+
+  res = exec(input, {});
+  out = fc::raw::unpack<exec_output_with_gas>(res->action_traces[0].return_value);
+  BOOST_REQUIRE(out.status == 0);
+  BOOST_REQUIRE(out.data.empty());
+  BOOST_REQUIRE(out.gas_used == 21000 + 4 * 31 + 16);
+
+  // A balance override lets an account without funds send value
+  evm_eoa evm2_unfunded;
+  exec_input send;
+  send.from  = bytes{std::begin(evm2_unfunded.address.bytes), std::end(evm2_unfunded.address.bytes)};
+  send.to    = bytes{std::begin(evm2.address.bytes), std::end(evm2.address.bytes)};
+  send.value = bytes{0x01};
+
+  res = execbatch({send});
+  auto outs = fc::raw::unpack<std::vector<exec_output_with_gas>>(res->action_traces[0].return_value);
+  BOOST_REQUIRE(outs[0].status != 0);
+
+  state_override funds{.address = *send.from, .balance = bytes{0x10}};
+  res = execbatch({send, send}, std::vector<state_override>{funds});
+  outs = fc::raw::unpack<std::vector<exec_output_with_gas>>(res->action_traces[0].return_value);
+  BOOST_REQUIRE(outs.size() == 2);
+  BOOST_REQUIRE(outs[0].status == 0);
+  BOOST_REQUIRE(outs[1].status == 0);
+  BOOST_REQUIRE(outs[0].gas_used == 21000);
+  BOOST_REQUIRE(!evm_balance(evm2));
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(sstore_on_overridden_slot, exec_evm_tester) try {
+
+  evm_eoa evm1;
+  transfer_token("alice"_n, "evm"_n, make_asset(1000000), evm1.address_0x());
+
+  // Runtime code: sstore(0, calldata[0:32])
+  //    600035 6000 55 00
+  // prefixed by an init code returning it
+  //    6007 600c 6000 39 6007 6000 f3
+  const auto contract_addr = deploy_contract(evm1, evmc::from_hex("6007600c60003960076000f360003560005500").value());
+
+  auto word = [](uint64_t v) {
+    evmc::bytes32 w{v};
+    return bytes{std::begin(w.bytes), std::end(w.bytes)};
+  };
+  const bytes contract{std::begin(contract_addr.bytes), std::end(contract_addr.bytes)};
+
+  // Slot 0 holds 5 on chain
+  auto txn = generate_tx(contract_addr, 0, 100'000);
+  txn.data = evmc::from_hex("0000000000000000000000000000000000000000000000000000000000000005").value();
+  evm1.sign(txn);
+  pushtx(txn);
+
+  exec_input input;
+  input.to   = contract;
+  input.data = word(1);
+
+  auto gas_used = [&](const std::vector<state_override>& overrides) {
+    auto res = exec(input, {}, overrides);
+    auto out = fc::raw::unpack<exec_output_with_gas>(res->action_traces[0].return_value);
+    BOOST_REQUIRE(out.status == 0);
+    return uint64_t(out.gas_used);
+  };
+
+  const uint64_t nonzero_original = gas_used({});
+
+  // Overriding the slot to zero prices the write as a new slot
+  const uint64_t zero_original = gas_used({{.address = contract, .storage = {{word(0), word(0)}}}});
+  BOOST_REQUIRE(zero_original > nonzero_original);
+
+  // Same code on another address, slot 0 only holds 5 through the override
+  evm_eoa other;
+  input.to = bytes{std::begin(other.address.bytes), std::end(other.address.bytes)};
+  const auto code = evmc::from_hex("60003560005500").value();
+  state_override code_override{.address = input.to, .code = bytes{code.begin(), code.end()}};
+  BOOST_REQUIRE(gas_used({code_override}) == zero_original);
+
+  code_override.storage = {{word(0), word(5)}};
+  BOOST_REQUIRE(gas_used({code_override}) == nonzero_original);
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(estimate_gas, exec_evm_tester) try {
+
+  // Fund evm1 address with 100 EOS
+  evm_eoa evm1, evm2;
+  const int64_t to_bridge = 1000000;
+  transfer_token("alice"_n, "evm"_n, make_asset(to_bridge), evm1.address_0x());
+
+  auto token_addr = deploy_evm_token_contract(evm1);
+
+  silkworm::Bytes data;
+  data += evmc::from_hex("a9059cbb").value();   // sha3(transfer(address,uint256))[:4]
+  data += silkworm::to_bytes32(evm2.address);   // to
+  data += evmc::bytes32{1111};                  // value
+
+  exec_input input;
+  input.from = bytes{std::begin(evm1.address.bytes), std::end(evm1.address.bytes)};
+  input.to   = bytes{std::begin(token_addr.bytes), std::end(token_addr.bytes)};
+  input.data = bytes{data.begin(), data.end()};
+
+  auto out = fc::raw::unpack<exec_output_with_gas>(estimategas(input)->action_traces[0].return_value);
+  BOOST_REQUIRE(out.status == 0);
+  const uint64_t estimate = out.gas_used;
+
+  auto used = fc::raw::unpack<exec_output_with_gas>(exec(input, {})->action_traces[0].return_value).gas_used;
+  BOOST_REQUIRE(estimate >= used);
+
+  auto balance_of_evm2 = [&]() {
+    auto res = erc20_balance(token_addr, evm2);
+    auto out = fc::raw::unpack<exec_output>(res->action_traces[0].return_value);
+    return intx::be::unsafe::load<intx::uint256>(reinterpret_cast<const uint8_t*>(out.data.data()));
+  };
+
+  // One gas less than the estimate is not enough
+  auto txn = generate_tx(token_addr, 0, estimate - 1);
+  txn.data = data;
+  evm1.sign(txn);
+  pushtx(txn);
+  BOOST_REQUIRE(balance_of_evm2() == 0);
+
+  txn = generate_tx(token_addr, 0, estimate);
+  txn.data = data;
+  evm1.sign(txn);
+  pushtx(txn);
+  BOOST_REQUIRE(balance_of_evm2() == 1111);
+
+  // Failing calls are reported as they are
+  evm_eoa evm3;
+  input.from = bytes{std::begin(evm3.address.bytes), std::end(evm3.address.bytes)};
+  out = fc::raw::unpack<exec_output_with_gas>(estimategas(input)->action_traces[0].return_value);
+  BOOST_REQUIRE(out.status != 0);
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
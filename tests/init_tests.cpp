@@ -76,6 +76,11 @@ BOOST_FIXTURE_TEST_CASE(check_init, basic_evm_tester) try {
 } FC_LOG_AND_RETHROW()
 
 
+// A contract built WITH_HOST_CRYPTO calls the k1_recover and sha3 host functions
+BOOST_FIXTURE_TEST_CASE(crypto_primitives_activated, basic_evm_tester) try {
+   BOOST_REQUIRE(control->is_builtin_activated(builtin_protocol_feature_t::crypto_primitives));
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE(check_freeze, basic_evm_tester) try {
    init(15555);
    produce_block();
@@ -781,4 +781,105 @@ BOOST_FIXTURE_TEST_CASE(evm_eos_fanout_out_of_gas, native_token_evm_tester_EOS)
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE(deposit_fast_path, native_token_evm_tester_EOS) try {
+   evm_eoa evm1, evm2;
+   const intx::uint256 smallest = 100_szabo;
+
+   setversion(1, evm_account_name);
+   produce_blocks(2);
+
+   auto deposit_tx = [&](const std::string& memo, int64_t to_bridge) {
+      auto trace = transfer_token("alice"_n, "evm"_n, make_asset(to_bridge), memo);
+      const auto& act = trace->action_traces.back().act;
+      BOOST_REQUIRE(act.account == "evm"_n);
+      BOOST_REQUIRE(act.name == "evmtx"_n);
+
+      auto evmtx_v = fc::raw::unpack<evm_test::evmtx_type>(act.data.data(), act.data.size());
+      const auto& evmtx = std::get<evm_test::evmtx_v0>(evmtx_v);
+      BOOST_REQUIRE(evmtx.eos_evm_version == 1);
+
+      silkworm::Transaction tx;
+      silkworm::ByteView bv{(const uint8_t*)evmtx.rlptx.data(), evmtx.rlptx.size()};
+      silkworm::rlp::decode(bv, tx);
+      BOOST_REQUIRE(bv.empty());
+      BOOST_REQUIRE(tx.value == smallest * to_bridge);
+      BOOST_REQUIRE(tx.gas_limit == 21000);
+      return tx;
+   };
+
+   // New account, then an existing one
+   auto tx1 = deposit_tx(evm1.address_0x(), 1'0000);
+   BOOST_REQUIRE(tx1.to == evm1.address);
+   BOOST_REQUIRE(evm_balance(evm1) == smallest * 1'0000);
+   BOOST_REQUIRE(find_account_by_address(evm1.address)->nonce == 0);
+
+   auto tx2 = deposit_tx(evm1.address_0x(), 1234);
+   BOOST_REQUIRE(tx2.nonce == tx1.nonce + 1);
+   BOOST_REQUIRE(evm_balance(evm1) == smallest * 1'1234);
+   check_balances();
+
+   // An account with code still goes through the EVM
+   transfer_token("alice"_n, "evm"_n, make_asset(10'0000), evm2.address_0x());
+   const evmc::address stop_addr = deploy_contract(evm2, evmc::from_hex("60016000f3").value());
+   auto tx3 = deposit_tx(fc::variant(stop_addr).as_string(), 5000);
+   BOOST_REQUIRE(tx3.nonce == tx2.nonce + 2);
+   BOOST_REQUIRE(evm_balance(stop_addr) == smallest * 5000);
+
+   check_balances();
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(batch_deposit, native_token_evm_tester_EOS) try {
+   evm_eoa evm1, evm2, evm3;
+   const intx::uint256 smallest = 100_szabo;
+
+   BOOST_REQUIRE_EXCEPTION(batchdeposit("alice"_n, {{evm1.address, make_asset(1'0000)}}),
+                           eosio_assert_message_exception, eosio_assert_message_is("account is not open"));
+
+   open("alice"_n);
+   transfer_token("alice"_n, "evm"_n, make_asset(10'0000), "alice");
+
+   BOOST_REQUIRE_EXCEPTION(batchdeposit("alice"_n, {{evm1.address, make_asset(6'0000)}, {evm2.address, make_asset(5'0000)}}),
+                           eosio_assert_message_exception, eosio_assert_message_is("overdrawn balance"));
+   BOOST_REQUIRE_EXCEPTION(batchdeposit("alice"_n, {}),
+                           eosio_assert_message_exception, eosio_assert_message_is("no deposits"));
+
+   setversion(1, evm_account_name);
+   produce_blocks(2);
+
+   // evm3 gets a contract so its deposit runs in the EVM
+   transfer_token("alice"_n, "evm"_n, make_asset(1'0000), evm3.address_0x());
+   const evmc::address stop_addr = deploy_contract(evm3, evmc::from_hex("60016000f3").value());
+   const auto inevm_before = inevm();
+
+   auto trace = batchdeposit("alice"_n, {{evm1.address, make_asset(1'0000)},
+                                         {stop_addr, make_asset(2'0000)},
+                                         {evm2.address, make_asset(3'0000)},
+                                         {evm1.address, make_asset(4'0000)}});
+
+   // One event per deposit, in list order with consecutive nonces
+   std::vector<silkworm::Transaction> events;
+   for (const auto& at : trace->action_traces) {
+      if (at.act.name != "evmtx"_n) continue;
+      auto evmtx_v = fc::raw::unpack<evm_test::evmtx_type>(at.act.data.data(), at.act.data.size());
+      const auto& evmtx = std::get<evm_test::evmtx_v0>(evmtx_v);
+      silkworm::ByteView bv{(const uint8_t*)evmtx.rlptx.data(), evmtx.rlptx.size()};
+      silkworm::rlp::decode(bv, events.emplace_back());
+   }
+   BOOST_REQUIRE(events.size() == 4);
+   const std::vector<evmc::address> expected_to{evm1.address, stop_addr, evm2.address, evm1.address};
+   for (size_t i = 0; i < events.size(); ++i) {
+      BOOST_REQUIRE(events[i].to == expected_to[i]);
+      BOOST_REQUIRE(events[i].nonce == events[0].nonce + i);
+   }
+
+   BOOST_REQUIRE(vault_balance_token("alice"_n) == 0);
+   BOOST_REQUIRE(evm_balance(evm1) == smallest * 5'0000);
+   BOOST_REQUIRE(evm_balance(evm2) == smallest * 3'0000);
+   BOOST_REQUIRE(evm_balance(stop_addr) == smallest * 2'0000);
+   BOOST_REQUIRE(inevm().balance - inevm_before.balance == make_asset(10'0000));
+   check_balances();
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
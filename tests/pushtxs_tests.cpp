@@ -0,0 +1,188 @@
+#include <boost/test/unit_test.hpp>
+
+#include "basic_evm_tester.hpp"
+
+using namespace evm_test;
+using eosio::testing::eosio_assert_message_is;
+
+// Mirror of evm_runtime::tx_stats, returned by pushtx, pushtxs and call in a WITH_TX_STATS build
+struct table_stats_row {
+   uint32_t read;
+   uint32_t update;
+   uint32_t create;
+   uint32_t remove;
+};
+struct db_stats_row {
+   table_stats_row account;
+   table_stats_row storage;
+   table_stats_row code;
+   uint32_t        code_cache_hits;
+};
+struct tx_stats_row {
+   uint64_t     gas_used;
+   db_stats_row db;
+};
+FC_REFLECT(table_stats_row, (read)(update)(create)(remove))
+FC_REFLECT(db_stats_row, (account)(storage)(code)(code_cache_hits))
+FC_REFLECT(tx_stats_row, (gas_used)(db))
+
+struct pushtxs_tester : basic_evm_tester {
+   pushtxs_tester() {
+      create_accounts({"alice"_n});
+      transfer_token(faucet_account_name, "alice"_n, make_asset(10000'0000));
+      init();
+   }
+};
+
+BOOST_AUTO_TEST_SUITE(pushtxs_tests)
+
+BOOST_FIXTURE_TEST_CASE(batch_of_transfers, pushtxs_tester) try {
+
+   evm_eoa evm1, evm2, evm3;
+   transfer_token("alice"_n, evm_account_name, make_asset(1000000), evm1.address_0x());
+
+   // Version 0 nodes only see transactions through the pushtx action
+   auto txn0 = generate_tx(evm2.address, 1_ether);
+   evm1.sign(txn0);
+   BOOST_REQUIRE_EXCEPTION(pushtxs({txn0}),
+      eosio_assert_message_exception, eosio_assert_message_is("pushtxs requires evm version 1 or later"));
+   evm1.next_nonce--;
+
+   setversion(1, evm_account_name);
+   produce_blocks(2);
+
+   // evm2 spends funds it only receives earlier in the same batch
+   auto txn1 = generate_tx(evm2.address, 10_ether);
+   evm1.sign(txn1);
+   auto txn2 = generate_tx(evm2.address, 5_ether);
+   evm1.sign(txn2);
+   auto txn3 = generate_tx(evm3.address, 1_ether);
+   evm2.sign(txn3);
+
+   auto trace = pushtxs({txn1, txn2, txn3});
+
+   BOOST_REQUIRE(trace->action_traces.size() == 4);
+   BOOST_REQUIRE(trace->action_traces[0].act.name == "pushtxs"_n);
+   for (size_t i = 1; i < trace->action_traces.size(); ++i) {
+      BOOST_REQUIRE(trace->action_traces[i].act.account == evm_account_name);
+      BOOST_REQUIRE(trace->action_traces[i].act.name == "evmtx"_n);
+   }
+
+   BOOST_REQUIRE(evm_balance(evm3) == 1_ether);
+   BOOST_REQUIRE(evm_balance(evm2) < 14_ether);
+   BOOST_REQUIRE(evm_balance(evm2) > 13_ether);
+
+   BOOST_REQUIRE(find_account_by_address(evm1.address)->nonce == 2);
+   BOOST_REQUIRE(find_account_by_address(evm2.address)->nonce == 1);
+
+   // A failing transaction aborts the whole batch
+   auto txn4 = generate_tx(evm3.address, 1_ether);
+   evm1.sign(txn4);
+   auto txn5 = generate_tx(evm1.address, 100_ether);
+   evm3.sign(txn5);
+
+   BOOST_REQUIRE_EXCEPTION(pushtxs({txn4, txn5}),
+      eosio_assert_message_exception, eosio::testing::fc_exception_message_contains("Insufficient funds"));
+   BOOST_REQUIRE(evm_balance(evm3) == 1_ether);
+
+   BOOST_REQUIRE_EXCEPTION(pushtxs({}),
+      eosio_assert_message_exception, eosio_assert_message_is("no transactions"));
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(batch_timings, pushtxs_tester) try {
+
+   evm_eoa evm1, evm2;
+   transfer_token("alice"_n, evm_account_name, make_asset(1000000), evm1.address_0x());
+
+   setversion(1, evm_account_name);
+   produce_blocks(2);
+
+   for (size_t batch = 0; batch < 5; ++batch) {
+      std::vector<silkworm::Transaction> txns;
+      for (size_t i = 0; i < 3; ++i) {
+         auto txn = generate_tx(evm2.address, 1_ether);
+         evm1.sign(txn);
+         txns.push_back(txn);
+      }
+      record_timings(pushtxs(txns));
+      produce_blocks(1);
+   }
+
+   // One entry per action run by the contract, the inline evmtx events included
+   BOOST_REQUIRE(action_timings["pushtxs"_n].size() == 5);
+   BOOST_REQUIRE(action_timings["evmtx"_n].size() == 15);
+   BOOST_REQUIRE(action_timings.count("pushtx"_n) == 0);
+   for (const auto& [action, elapsed] : action_timings) {
+      for (auto us : elapsed) BOOST_REQUIRE(us >= 0);
+   }
+
+} FC_LOG_AND_RETHROW()
+
+// Needs the test build of the contract (WITH_TX_STATS), see the test_build_tests ctest
+BOOST_TEST_DECORATOR(* boost::unit_test::label("test_build"))
+BOOST_FIXTURE_TEST_CASE(tx_stats_layout, pushtxs_tester) try {
+
+   evm_eoa evm1, evm2;
+   transfer_token("alice"_n, evm_account_name, make_asset(1000000), evm1.address_0x());
+
+   setversion(1, evm_account_name);
+   produce_blocks(2);
+
+   // Deposits run their transactions from a notification, they never report stats
+   auto deposit = transfer_token("alice"_n, evm_account_name, make_asset(10000), evm2.address_0x());
+   for (const auto& at : deposit->action_traces) {
+      if (at.receiver == evm_account_name) BOOST_REQUIRE(at.return_value.empty());
+   }
+
+   auto txn1 = generate_tx(evm2.address, 1_ether);
+   evm1.sign(txn1);
+   auto txn2 = generate_tx(evm2.address, 1_ether);
+   evm1.sign(txn2);
+
+   auto trace = pushtxs({txn1, txn2});
+   const auto& rv = trace->action_traces[0].return_value;
+   BOOST_REQUIRE_MESSAGE(!rv.empty(), "contract built without WITH_TX_STATS");
+
+   // varuint32 count, then per transaction gas_used (8), three table_stats (3 * 16) and code_cache_hits (4)
+   BOOST_REQUIRE(rv.size() == 1 + 2 * 60);
+   BOOST_REQUIRE(rv[0] == 2);
+
+   auto stats = fc::raw::unpack<std::vector<tx_stats_row>>(rv);
+   BOOST_REQUIRE(stats.size() == 2);
+   BOOST_REQUIRE(stats[0].db.account.read > 0);
+   for (const auto& s : stats) {
+      BOOST_REQUIRE(s.gas_used == 21000);
+      // sender and recipient, rows read by the first transaction are cached for the second one
+      BOOST_REQUIRE(s.db.account.update >= 2);
+   }
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(miner_cut_of_batch, pushtxs_tester) try {
+
+   evm_eoa evm1, evm2;
+   transfer_token("alice"_n, evm_account_name, make_asset(1000000), evm1.address_0x());
+
+   setversion(1, evm_account_name);
+   produce_blocks(2);
+
+   auto txn1 = generate_tx(evm2.address, 1_ether);
+   evm1.sign(txn1);
+   auto txn2 = generate_tx(evm2.address, 1_ether);
+   evm1.sign(txn2);
+
+   BOOST_REQUIRE_EXCEPTION(pushtxs({txn1, txn2}, "alice"_n),
+      eosio_assert_message_exception, eosio_assert_message_is("no balance open for miner"));
+
+   open("alice"_n);
+   pushtxs({txn1, txn2}, "alice"_n);
+
+   // Both cuts end up in the miner balance
+   const intx::uint256 cut = 21000_u256 * get_config().gas_price * suggested_miner_cut / 100'000;
+   BOOST_REQUIRE(intx::uint256(vault_balance("alice"_n)) == 2 * cut);
+   check_balances();
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,177 @@
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+
+#include "basic_evm_tester.hpp"
+
+using namespace evm_test;
+
+struct storage_tester : basic_evm_tester {
+   storage_tester() {
+      create_accounts({"alice"_n});
+      transfer_token(faucet_account_name, "alice"_n, make_asset(10000'0000));
+      init();
+   }
+
+   // Runtime code: sstore(calldata[0:32], sload(calldata[0:32]) + calldata[32:64])
+   //    600035 80 54 602035 01 90 55 00
+   // prefixed by an init code returning it
+   //    600c 600c 6000 39 600c 6000 f3
+   const std::string accumulator_bytecode = "600c600c600039600c6000f3600035805460203501905500";
+
+   void add(evm_eoa& eoa, const evmc::address& contract, const intx::uint256& key, const intx::uint256& value) {
+      auto txn = generate_tx(contract, 0, 500'000);
+      uint8_t buffer[64];
+      intx::be::unsafe::store(buffer, key);
+      intx::be::unsafe::store(buffer + 32, value);
+      txn.data = silkworm::Bytes{buffer, sizeof(buffer)};
+      eoa.sign(txn);
+      pushtx(txn);
+   }
+
+   // slot key => (primary key, value)
+   std::map<intx::uint256, std::pair<uint64_t, intx::uint256>> load_slots(uint64_t account_id) {
+      std::map<intx::uint256, std::pair<uint64_t, intx::uint256>> slots;
+      BOOST_REQUIRE(scan_account_storage(account_id, [&](storage_slot&& slot) -> bool {
+         slots[slot.key] = {slot.id, slot.value};
+         return false;
+      }));
+      return slots;
+   }
+};
+
+BOOST_AUTO_TEST_SUITE(storage_tests)
+
+BOOST_FIXTURE_TEST_CASE(colliding_slots, storage_tester) try {
+
+   evm_eoa evm1;
+   transfer_token("alice"_n, evm_account_name, make_asset(1000000), evm1.address_0x());
+
+   auto contract_addr = deploy_contract(evm1, evmc::from_hex(accumulator_bytecode).value());
+   uint64_t contract_account_id = find_account_by_address(contract_addr).value().id;
+
+   // a, b and c share a home primary key, d has the next one
+   const intx::uint256 a = 1;
+   const uint64_t home = storage2_home_key(a);
+   const intx::uint256 b = storage2_slot_with_home_key(home, 1);
+   const intx::uint256 c = storage2_slot_with_home_key(home, 2);
+   const intx::uint256 d = storage2_slot_with_home_key(home + 1, 3);
+   const intx::uint256 e = storage2_slot_with_home_key(home, 4);
+
+   add(evm1, contract_addr, a, 10);
+   add(evm1, contract_addr, b, 20);
+   add(evm1, contract_addr, c, 30);
+   add(evm1, contract_addr, d, 40);
+
+   auto slots = load_slots(contract_account_id);
+   BOOST_REQUIRE(slots.size() == 4);
+   BOOST_REQUIRE(slots[a] == std::make_pair(home, intx::uint256(10)));
+   BOOST_REQUIRE(slots[b] == std::make_pair(home + 1, intx::uint256(20)));
+   BOOST_REQUIRE(slots[c] == std::make_pair(home + 2, intx::uint256(30)));
+   BOOST_REQUIRE(slots[d] == std::make_pair(home + 3, intx::uint256(40)));
+
+   // Reads follow the probe chain
+   add(evm1, contract_addr, b, 5);
+   add(evm1, contract_addr, d, 5);
+   slots = load_slots(contract_account_id);
+   BOOST_REQUIRE(slots[b].second == 25);
+   BOOST_REQUIRE(slots[d].second == 45);
+
+   // Clearing b leaves a tombstone since c and d are further down the chain
+   add(evm1, contract_addr, b, intx::uint256(0) - 25);
+   slots = load_slots(contract_account_id);
+   BOOST_REQUIRE(slots.size() == 3);
+   BOOST_REQUIRE(slots.find(b) == slots.end());
+
+   add(evm1, contract_addr, c, 1);
+   slots = load_slots(contract_account_id);
+   BOOST_REQUIRE(slots[c] == std::make_pair(home + 2, intx::uint256(31)));
+
+   // New slots reuse the tombstone
+   add(evm1, contract_addr, e, 50);
+   slots = load_slots(contract_account_id);
+   BOOST_REQUIRE(slots.size() == 4);
+   BOOST_REQUIRE(slots[e] == std::make_pair(home + 1, intx::uint256(50)));
+
+   // Clearing the end of the chain
+   add(evm1, contract_addr, d, intx::uint256(0) - 45);
+   add(evm1, contract_addr, c, intx::uint256(0) - 31);
+   slots = load_slots(contract_account_id);
+   BOOST_REQUIRE(slots.size() == 2);
+   BOOST_REQUIRE(slots[a] == std::make_pair(home, intx::uint256(10)));
+   BOOST_REQUIRE(slots[e] == std::make_pair(home + 1, intx::uint256(50)));
+
+   add(evm1, contract_addr, d, 7);
+   slots = load_slots(contract_account_id);
+   BOOST_REQUIRE(slots[d] == std::make_pair(home + 2, intx::uint256(7)));
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(spread_slots, storage_tester) try {
+
+   evm_eoa evm1;
+   transfer_token("alice"_n, evm_account_name, make_asset(1000000), evm1.address_0x());
+
+   auto contract_addr = deploy_contract(evm1, evmc::from_hex(accumulator_bytecode).value());
+   uint64_t contract_account_id = find_account_by_address(contract_addr).value().id;
+
+   // Small consecutive slots and slots differing in a single word get unrelated home keys
+   const std::vector<intx::uint256> keys = {
+      1, 2, 3, intx::uint256(1) << 64, intx::uint256(1) << 128, intx::uint256(1) << 192};
+   for (const auto& key : keys) {
+      add(evm1, contract_addr, key, 1);
+   }
+
+   auto slots = load_slots(contract_account_id);
+   BOOST_REQUIRE(slots.size() == keys.size());
+   std::set<uint64_t> ids;
+   for (const auto& key : keys) {
+      BOOST_REQUIRE(slots[key].first == storage2_home_key(key));
+      ids.insert(slots[key].first);
+   }
+   BOOST_REQUIRE(ids.size() == keys.size());
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(miss_in_dense_cluster, storage_tester) try {
+
+   evm_eoa evm1;
+   transfer_token("alice"_n, evm_account_name, make_asset(1000000), evm1.address_0x());
+
+   auto contract_addr = deploy_contract(evm1, evmc::from_hex(accumulator_bytecode).value());
+   uint64_t contract_account_id = find_account_by_address(contract_addr).value().id;
+
+   // Rows home .. home + 3 are all taken, by slots of home keys home and home + 2
+   const uint64_t home = storage2_home_key(7);
+   const std::vector<intx::uint256> cluster = {
+      storage2_slot_with_home_key(home, 1),
+      storage2_slot_with_home_key(home, 2),
+      storage2_slot_with_home_key(home + 2, 3),
+      storage2_slot_with_home_key(home + 2, 4)};
+   for (size_t i = 0; i < cluster.size(); ++i) {
+      add(evm1, contract_addr, cluster[i], 10 + i);
+   }
+
+   auto slots = load_slots(contract_account_id);
+   for (size_t i = 0; i < cluster.size(); ++i) {
+      BOOST_REQUIRE(slots[cluster[i]] == std::make_pair(home + i, intx::uint256(10 + i)));
+   }
+
+   // Missing slots whose home key is inside the cluster read as zero and are
+   // inserted right after it, the cluster is left untouched
+   const intx::uint256 x = storage2_slot_with_home_key(home + 1, 5);
+   const intx::uint256 y = storage2_slot_with_home_key(home + 3, 6);
+   add(evm1, contract_addr, x, 5);
+   add(evm1, contract_addr, y, 6);
+
+   slots = load_slots(contract_account_id);
+   BOOST_REQUIRE(slots.size() == cluster.size() + 2);
+   for (size_t i = 0; i < cluster.size(); ++i) {
+      BOOST_REQUIRE(slots[cluster[i]] == std::make_pair(home + i, intx::uint256(10 + i)));
+   }
+   BOOST_REQUIRE(slots[x] == std::make_pair(home + 4, intx::uint256(5)));
+   BOOST_REQUIRE(slots[y] == std::make_pair(home + 5, intx::uint256(6)));
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()